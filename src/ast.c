@@ -1,9 +1,86 @@
+#include <stdalign.h>
 #include <stdlib.h>
 
 #include "ast.h"
 
-struct node* node_new(int type, const struct token* token, struct node* left, struct node* right) {
-    struct node* n = malloc(sizeof(*n));
+#define AST_BLOCK_SIZE (64 * 1024)
+
+// bigger requests get a block of their own, so the current block is not left unfinished
+#define AST_LARGE_SIZE (AST_BLOCK_SIZE / 4)
+
+#define align_size(size) \
+    (((size) + alignof(max_align_t) - 1) & ~(alignof(max_align_t) - 1))
+
+struct ast_block {
+    struct ast_block* next;
+    size_t used;
+    size_t size;
+    alignas(max_align_t) unsigned char data[];
+};
+
+static struct ast_block* new_block(size_t size) {
+    struct ast_block* block = malloc(sizeof(*block) + size);
+    if (!block)
+        return NULL;
+
+    *block = (struct ast_block) {
+        .size = size
+    };
+
+    return block;
+}
+
+void* ast_arena_alloc(struct ast_arena* arena, size_t size) {
+    size = align_size(size);
+
+    struct ast_block* head = arena->blocks;
+
+    if (size > AST_LARGE_SIZE) {
+        struct ast_block* block = new_block(size);
+        if (!block)
+            return NULL;
+
+        block->used = size;
+
+        // linked behind the head, the allocations continue in the current block
+        if (head) {
+            block->next = head->next;
+            head->next = block;
+        } else {
+            arena->blocks = block;
+        }
+
+        return block->data;
+    }
+
+    if (!head || head->used + size > head->size) {
+        head = new_block(AST_BLOCK_SIZE);
+        if (!head)
+            return NULL;
+
+        head->next = arena->blocks;
+        arena->blocks = head;
+    }
+
+    void* mem = &head->data[head->used];
+    head->used += size;
+
+    return mem;
+}
+
+void ast_arena_free(struct ast_arena* arena) {
+    struct ast_block* block = arena->blocks;
+    while (block) {
+        struct ast_block* next = block->next;
+        free(block);
+        block = next;
+    }
+
+    arena->blocks = NULL;
+}
+
+struct node* node_new(struct ast_arena* arena, int type, const struct token* token, struct node* left, struct node* right) {
+    struct node* n = ast_arena_alloc(arena, sizeof(*n));
     if (!n) {
         return NULL;
     }
@@ -20,13 +97,3 @@ struct node* node_new(int type, const struct token* token, struct node* left, st
 
     return n;
 }
-
-void node_free(struct node* n) {
-    if (n->left)
-        node_free(n->left);
-
-    if (n->right)
-        node_free(n->right);
-
-    free(n);
-}
@@ -1,6 +1,7 @@
 #ifndef AST_H
 #define AST_H
 
+#include <stddef.h>
 #include <stdint.h>
 #include "lexer.h"
 
@@ -12,7 +13,35 @@ struct node {
     uint32_t flags;
 };
 
-struct node* node_new(int type, const struct token* token, struct node* left, struct node* right);
-void node_free(struct node* n);
+struct ast_block;
+
+/**
+ * memory of the nodes of a program and of the token texts the parser copies, the
+ * tree is released at once when the program doesn't need it anymore
+ *
+ * @field blocks blocks of the arena, the newest first
+ */
+struct ast_arena {
+    struct ast_block* blocks;
+};
+
+/**
+ * allocate memory that lives until the arena is freed
+ *
+ * @param arena arena
+ * @param size bytes count
+ *
+ * @return memory aligned for any type or NULL on failure
+ */
+void* ast_arena_alloc(struct ast_arena* arena, size_t size);
+
+/**
+ * release all of the memory of an arena, the nodes allocated from it become invalid
+ *
+ * @param arena arena
+ */
+void ast_arena_free(struct ast_arena* arena);
+
+struct node* node_new(struct ast_arena* arena, int type, const struct token* token, struct node* left, struct node* right);
 
 #endif // AST_H
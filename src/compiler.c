@@ -1,13 +1,17 @@
+#include <pthread.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <strings.h>
 #include <sys/types.h>
+#include <unistd.h>
 
 #include "parser.h"
 #include "compiler.h"
 #include "objects.h"
 #include "instructions.h"
+#include "sylk.h"
 #include "sylk_lib.h"
 #include "utils.h"
 
@@ -28,19 +32,91 @@ struct compiler_data {
 
     struct var locals[1024];
     uint32_t n_locals;
+
+    bool memo;
+
+    struct lazy_table* lazy;
 };
 
+/**
+ * function or method compiled separately from the code that defines it
+ *
+ * @field ast function node
+ * @field locals variables visible from the function
+ * @field n_locals variables count
+ * @field function_scope function nesting of the definition
+ * @field current_scope block nesting of the definition
+ * @field chunk compiled body waiting to be linked
+ * @field compiled true if the body was linked
+ * @field index address of the body once linked
+ */
+struct lazy_function {
+    struct node* ast;
+
+    struct var* locals;
+    uint32_t n_locals;
+
+    uint32_t function_scope;
+    int32_t current_scope;
+
+    struct binary_data* chunk;
+
+    bool compiled;
+    int32_t index;
+};
+
+// functions compiled by every thread before starting a new one
+#define MIN_FUNCTIONS_PER_THREAD 8
+
+// stubs store the lazy function id as a negative index
+#define lazy_index(id) \
+    (-(id) - 1)
+
+// room reserved for the biggest instruction with its operands
+#define MAX_INSTRUCTION_SIZE 16
+
+/**
+ * constants and program of a chunk, every function is compiled in its own chunk
+ *
+ * @field constants_bytes constant pool
+ * @field n_constants_bytes constant pool size
+ * @field allocated_constants constant pool capacity
+ * @field program_bytes instructions
+ * @field n_program_bytes instructions size
+ * @field allocated_program instructions capacity
+ */
 struct binary_data {
-    uint8_t constants_bytes[4048];
+    uint8_t* constants_bytes;
     uint32_t n_constants_bytes;
+    uint32_t allocated_constants;
 
-    uint8_t classes[4048];
-    uint32_t n_classes;
-
-    uint8_t program_bytes[4048];
+    uint8_t* program_bytes;
     uint32_t n_program_bytes;
+    uint32_t allocated_program;
 };
 
+static int reserve_bytes(uint8_t** bytes, uint32_t* allocated, uint32_t n_bytes, uint32_t n_needed) {
+    if (n_bytes + n_needed <= *allocated)
+        return 0;
+
+    uint32_t new_size = *allocated ? *allocated * 2 : 256;
+    while (new_size < n_bytes + n_needed) {
+        new_size *= 2;
+    }
+
+    uint8_t* new_bytes = realloc(*bytes, new_size);
+    CHECK_MEM(new_bytes);
+
+    *bytes = new_bytes;
+    *allocated = new_size;
+    return 0;
+}
+
+static void binary_data_free(struct binary_data* data) {
+    free(data->constants_bytes);
+    free(data->program_bytes);
+}
+
 static void add_variable(const char* var_name, uint32_t scope, uint32_t index, bool constant, struct compiler_data* e) {
     e->locals[e->n_locals++] = (struct var) {
         .name = var_name,
@@ -99,25 +175,26 @@ static struct sylk_named_class* get_class(const char* class_name, struct compile
 }
 
 static int32_t add_constant(struct binary_data* data, const struct sylk_object* o, int32_t* out_address) {
+    uint32_t n_needed = sizeof(int32_t) + sizeof(struct sylk_object_class);
+    CHECK(reserve_bytes(&data->constants_bytes, &data->allocated_constants, data->n_constants_bytes, n_needed), "failed to grow the constant pool");
+
     uint32_t constant_address = data->n_constants_bytes;
 
     *(int32_t*)(&data->constants_bytes[data->n_constants_bytes]) = o->type;
     data->n_constants_bytes += sizeof(int32_t);
 
+    // the numbers are not aligned in the pool
     if (o->type == SYLK_OBJ_NUMBER) {
-        *(int32_t*)(&data->constants_bytes[data->n_constants_bytes]) = o->num_value;
-        data->n_constants_bytes += sizeof(int32_t);
+        memcpy(&data->constants_bytes[data->n_constants_bytes], &o->num_value, sizeof(o->num_value));
+        data->n_constants_bytes += sizeof(o->num_value);
 
         *out_address = constant_address;
         return 0;
     }
 
-    if (o->type == SYLK_OBJ_STRING) {
-        strcpy((char*)&data->constants_bytes[data->n_constants_bytes], o->str_value);
-        data->n_constants_bytes += strlen(o->str_value);
-
-        data->constants_bytes[data->n_constants_bytes] = '\0';
-        ++data->n_constants_bytes;
+    if (o->type == SYLK_OBJ_FLOAT) {
+        memcpy(&data->constants_bytes[data->n_constants_bytes], &o->float_value, sizeof(o->float_value));
+        data->n_constants_bytes += sizeof(o->float_value);
 
         *out_address = constant_address;
         return 0;
@@ -143,13 +220,39 @@ static int32_t add_constant(struct binary_data* data, const struct sylk_object*
 }
 
 
-#define add_instruction(code) \
+// string constants refer to the interned strings, so the same literal is the same object in every chunk
+static int32_t add_string(struct compiler_data* cd, struct binary_data* data, const char* chars, int32_t* out_address) {
+    struct sylk_string* string = intern(&cd->lazy->s->strings, chars, strlen(chars));
+    CHECK_MEM(string);
+
+    uint32_t n_needed = sizeof(int32_t) + sizeof(string);
+    CHECK(reserve_bytes(&data->constants_bytes, &data->allocated_constants, data->n_constants_bytes, n_needed), "failed to grow the constant pool");
+
+    uint32_t constant_address = data->n_constants_bytes;
+
+    *(int32_t*)(&data->constants_bytes[data->n_constants_bytes]) = SYLK_OBJ_STRING;
+    data->n_constants_bytes += sizeof(int32_t);
+
+    *(struct sylk_string**)(&data->constants_bytes[data->n_constants_bytes]) = string;
+    data->n_constants_bytes += sizeof(string);
+
+    *out_address = constant_address;
+    return 0;
+}
+
+// the operands and placeholders that follow an instruction always fit
+#define add_instruction_data(data, code) \
 { \
-    data->program_bytes[(data->n_program_bytes)++] = code; \
+    CHECK(reserve_bytes(&(data)->program_bytes, &(data)->allocated_program, (data)->n_program_bytes, MAX_INSTRUCTION_SIZE), "failed to grow the program"); \
+    (data)->program_bytes[((data)->n_program_bytes)++] = code; \
 }
 
+#define add_instruction(code) \
+    add_instruction_data(data, code)
+
 #define add_number(num) \
 { \
+    CHECK(reserve_bytes(&data->program_bytes, &data->allocated_program, data->n_program_bytes, sizeof(int32_t)), "failed to grow the program"); \
     int32_t int_value = (int32_t)(num); \
     memcpy(&data->program_bytes[data->n_program_bytes], &int_value, sizeof(int_value)); \
     data->n_program_bytes += sizeof(int_value); \
@@ -168,6 +271,244 @@ static int32_t add_constant(struct binary_data* data, const struct sylk_object*
 
 
 int compile(struct compiler_data* cd, struct node* ast, struct binary_data* data, uint32_t* current_stack_index, uint32_t function_scope, int32_t current_scope, void* ctx);
+
+static uint32_t count_parameters(struct node* function) {
+    uint32_t n_parameters = 0;
+
+    struct node* parameter = function->left;
+    while (parameter) {
+        parameter = parameter->right;
+        ++n_parameters;
+    }
+
+    return n_parameters;
+}
+
+// compiles the parameters, the body and the return of a function or a method
+static int compile_function_body(struct compiler_data* cd, struct node* ast, struct binary_data* data, uint32_t function_scope, int32_t current_scope, void* ctx) {
+    uint32_t new_stack_index = 0;
+    uint32_t n_arguments = 0;
+
+    struct node* parameter = ast->left;
+    while (parameter) {
+        add_variable(parameter->token.value, current_scope + 1, new_stack_index++, false, cd);
+        parameter = parameter->right;
+        ++n_arguments;
+    }
+
+    add_variable("self", current_scope + 1, new_stack_index++, true, cd);
+
+    bool enclosing_memo = cd->memo;
+    cd->memo = ast->flags & MEMO;
+
+    // memoized functions return early with the cached result
+    if (cd->memo) {
+        pthread_mutex_lock(&cd->lazy->lock);
+        uint32_t memo_id = cd->lazy->n_memos++;
+        pthread_mutex_unlock(&cd->lazy->lock);
+
+        add_instruction(MEMO_GET);
+        add_number(memo_id);
+        add_number(n_arguments);
+    }
+
+    CHECK(compile(cd, ast->right, data, &new_stack_index, function_scope + 1, current_scope, ctx), "failed to compile function body");
+
+    if (ast->type == NODE_METHOD) {
+        // constructors return the instance
+        if (strcmp(ast->token.value, "constructor") == 0) {
+            add_instruction(DUP_LOC);
+            add_number(n_arguments);
+        } else {
+            add_instruction(PUSH_FALSE);
+        }
+    }
+
+    // TODO: double ret in case of return
+    add_instruction(cd->memo ? MEMO_RET : RET);
+
+    cd->memo = enclosing_memo;
+    return 0;
+}
+
+static int add_lazy_function(struct compiler_data* cd, struct node* ast, uint32_t function_scope, int32_t current_scope, int32_t* out_id) {
+    struct lazy_table* lazy = cd->lazy;
+
+    // the body sees the variables declared up to this point, there are none at the top of an empty program
+    struct var* locals = NULL;
+    if (cd->n_locals > 0) {
+        locals = malloc(cd->n_locals * sizeof(*locals));
+        CHECK_MEM(locals);
+
+        memcpy(locals, cd->locals, cd->n_locals * sizeof(*locals));
+    }
+
+    pthread_mutex_lock(&lazy->lock);
+
+    if (lazy->n_functions >= lazy->allocated) {
+        uint32_t new_size = lazy->allocated ? lazy->allocated * 2 : 16;
+
+        struct lazy_function* new_functions = realloc(lazy->functions, new_size * sizeof(*new_functions));
+        if (!new_functions) {
+            pthread_mutex_unlock(&lazy->lock);
+            free(locals);
+
+            MEMORY_ERROR();
+            return 1;
+        }
+
+        lazy->functions = new_functions;
+        lazy->allocated = new_size;
+    }
+
+    lazy->functions[lazy->n_functions] = (struct lazy_function) {
+        .ast = ast,
+        .locals = locals,
+        .n_locals = cd->n_locals,
+        .function_scope = function_scope,
+        .current_scope = current_scope
+    };
+
+    *out_id = lazy->n_functions++;
+
+    pthread_mutex_unlock(&lazy->lock);
+    return 0;
+}
+
+// moves a function by the program offset or replaces its stub with the linked body
+static void relocate_function(struct sylk_object_function* function, uint32_t program_offset, const struct lazy_table* lazy) {
+    if (function->type != SYLK_USER)
+        return;
+
+    if (function->index >= 0) {
+        function->index += program_offset;
+        return;
+    }
+
+    if (!lazy)
+        return;
+
+    const struct lazy_function* body = &lazy->functions[-function->index - 1];
+    if (body->compiled)
+        function->index = body->index;
+}
+
+static void relocate_constants(uint8_t* constants, uint32_t n_constants, uint32_t program_offset, const struct lazy_table* lazy) {
+    uint32_t i = 0;
+    while (i < n_constants) {
+        int32_t type = *(int32_t*)&constants[i];
+        i += sizeof(int32_t);
+
+        switch (type) {
+            case SYLK_OBJ_NUMBER:
+                i += sizeof(int64_t);
+                break;
+
+            case SYLK_OBJ_FLOAT:
+                i += sizeof(double);
+                break;
+
+            case SYLK_OBJ_STRING:
+                i += sizeof(struct sylk_string*);
+                break;
+
+            case SYLK_OBJ_FUNCTION:
+                {
+                    struct sylk_object_function* function = (struct sylk_object_function*)&constants[i];
+                    relocate_function(function, program_offset, lazy);
+
+                    i += sizeof(*function);
+                }
+                break;
+
+            case SYLK_OBJ_CLASS:
+                {
+                    struct sylk_object_class* cls = (struct sylk_object_class*)&constants[i];
+                    cls->index += program_offset;
+
+                    for (uint32_t j = 0; j < cls->n_methods; ++j) {
+                        relocate_function(&cls->methods[j].function, program_offset, lazy);
+                    }
+
+                    i += sizeof(*cls);
+                }
+                break;
+        }
+    }
+}
+
+// adds the offsets of the place where a chunk is linked to all of its addresses
+static void relocate(struct binary_data* data, uint32_t constants_offset, uint32_t program_offset) {
+    uint32_t i = 0;
+    while (i < data->n_program_bytes) {
+        uint8_t instruction = data->program_bytes[i++];
+        int32_t* operand = (int32_t*)&data->program_bytes[i];
+
+        switch (instruction) {
+            case PUSH:
+                operand[0] += constants_offset;
+                i += sizeof(int32_t);
+                break;
+
+            case JMP:
+            case JMP_NOT:
+            case PUSH_ADDR:
+                operand[0] += program_offset;
+                i += sizeof(int32_t);
+                break;
+
+            case FOR_ITER:
+                operand[1] += program_offset;
+                operand[2] += program_offset;
+                i += 3 * sizeof(int32_t);
+                break;
+
+            case PUSH_NUM:
+            case DUP:
+            case DUP_LOC:
+            case CALL:
+            case CHANGE:
+            case CHANGE_LOC:
+                i += sizeof(int32_t);
+                break;
+
+            case MEMO_GET:
+                i += 2 * sizeof(int32_t);
+                break;
+        }
+    }
+
+    relocate_constants(data->constants_bytes, data->n_constants_bytes, program_offset, NULL);
+}
+
+// copies the constants and the program of a chunk to their final addresses
+static void place(struct binary_data* data, uint8_t* bytecodes, uint32_t constants_address, uint32_t program_address, uint32_t start_address) {
+    relocate(data, constants_address, program_address - start_address);
+
+    // chunks without constants have no constant pool
+    if (data->n_constants_bytes > 0)
+        memcpy(bytecodes + constants_address, data->constants_bytes, data->n_constants_bytes);
+
+    memcpy(bytecodes + program_address, data->program_bytes, data->n_program_bytes);
+}
+
+// appends the constants and the program of a chunk to the bytecodes
+static int link_chunk(struct binary_data* data, uint8_t* bytecodes, uint32_t capacity, uint32_t* n_bytecodes, uint32_t start_address, int32_t* out_program_address) {
+    uint32_t constants_address = *n_bytecodes;
+    uint32_t program_address = constants_address + data->n_constants_bytes;
+
+    if (program_address + data->n_program_bytes > capacity) {
+        ERROR("program does not fit in %u bytes", capacity);
+        return 1;
+    }
+
+    place(data, bytecodes, constants_address, program_address, start_address);
+
+    *n_bytecodes = program_address + data->n_program_bytes;
+    *out_program_address = program_address - start_address;
+    return 0;
+}
+
 static int compile_lvalue(struct compiler_data* cd, struct node* ast, struct binary_data* data, uint32_t* current_stack_index, uint32_t function_scope, int32_t current_scope, void* ctx) {
     switch (ast->type) {
         case NODE_VAR:
@@ -198,7 +539,7 @@ static int compile_lvalue(struct compiler_data* cd, struct node* ast, struct bin
                 CHECK(compile(cd, ast->left, data, current_stack_index, function_scope, current_scope, ctx), "failed to compile left member of member access");
 
                 int32_t out_address;
-                add_constant(data, &(struct sylk_object){.type = SYLK_OBJ_STRING, .str_value = ast->token.value}, &out_address);
+                CHECK(add_string(cd, data, ast->token.value, &out_address), "failed to add constant");
 
                 add_instruction(PUSH);
                 add_number(out_address);
@@ -213,15 +554,10 @@ static int compile_lvalue(struct compiler_data* cd, struct node* ast, struct bin
 
                 CHECK(compile(cd, ast->left, data, current_stack_index, function_scope, current_scope, ctx), "failed to compile left member of member index");
 
-                int32_t out_address;
-                add_constant(data, &(struct sylk_object){.type = SYLK_OBJ_STRING, .str_value = "__set"}, &out_address);
-                add_instruction(PUSH)
-                add_number(out_address);
+                add_instruction(INDEX_SET);
 
-                add_instruction(GET_FIELD);
-
-                add_instruction(CALL);
-                add_number(2);
+                // discard the result of the store
+                add_instruction(POP);
 
                 return 0;
             }
@@ -242,8 +578,15 @@ int compile(struct compiler_data* cd, struct node* ast, struct binary_data* data
             {
                 add_instruction(PUSH);
 
+                struct sylk_object number = {.type = SYLK_OBJ_NUMBER};
+                if (ast->token.code == TOK_FLT) {
+                    number = (struct sylk_object){.type = SYLK_OBJ_FLOAT, .float_value = ast->token.float_value};
+                } else {
+                    number.num_value = ast->token.int_value;
+                }
+
                 int32_t constant_address;
-                CHECK(add_constant(data, &(struct sylk_object){.type = SYLK_OBJ_NUMBER, .num_value = *(int32_t*)ast->token.value}, &constant_address), "failed to add constant");
+                CHECK(add_constant(data, &number, &constant_address), "failed to add constant");
 
                 add_number(constant_address);
 
@@ -264,7 +607,7 @@ int compile(struct compiler_data* cd, struct node* ast, struct binary_data* data
                 add_instruction(PUSH);
 
                 int32_t constant_address;
-                CHECK(add_constant(data, &(struct sylk_object){.type = SYLK_OBJ_STRING, .str_value = ast->token.value}, &constant_address), "failed to add constant");
+                CHECK(add_string(cd, data, ast->token.value, &constant_address), "failed to add constant");
 
                 add_number(constant_address);
 
@@ -296,7 +639,7 @@ int compile(struct compiler_data* cd, struct node* ast, struct binary_data* data
                     };
 
                     int32_t out_address;
-                    add_constant(data, &o, &out_address);
+                    CHECK(add_constant(data, &o, &out_address), "failed to add constant");
 
                     add_instruction(PUSH);
                     add_number(out_address);
@@ -312,7 +655,7 @@ int compile(struct compiler_data* cd, struct node* ast, struct binary_data* data
                     };
 
                     int32_t out_address;
-                    add_constant(data, &o, &out_address);
+                    CHECK(add_constant(data, &o, &out_address), "failed to add constant");
 
                     add_instruction(PUSH);
                     add_number(out_address);
@@ -431,6 +774,105 @@ int compile(struct compiler_data* cd, struct node* ast, struct binary_data* data
                 return 0;
             }
 
+        case NODE_FOR:
+            {
+                // the iterable, the current position and the loop variable live in hidden locals
+                CHECK(compile(cd, ast->left, data, current_stack_index, function_scope, current_scope, ctx), "failed to compile iterable in for statement");
+
+                uint32_t iterable_index = *current_stack_index;
+                add_variable("@iterable", current_scope + 1, *current_stack_index, true, cd);
+                increment_index();
+
+                uint32_t position_index = *current_stack_index;
+                add_instruction(PUSH_NUM);
+                add_number(0);
+                add_variable("@position", current_scope + 1, *current_stack_index, true, cd);
+                increment_index();
+
+                uint32_t element_index = *current_stack_index;
+                add_instruction(PUSH_FALSE);
+                add_variable(ast->token.value, current_scope + 1, *current_stack_index, false, cd);
+                increment_index();
+
+                uint32_t start_index = data->n_program_bytes;
+
+                // builtin lists are walked natively and jump straight to the body
+                add_instruction(FOR_ITER);
+                add_number(iterable_index);
+                uint32_t placeholder_body = create_placeholder();
+                uint32_t placeholder_list_end = create_placeholder();
+
+                // any other object needs to implement "length" and "__get"
+                int32_t length_address;
+                CHECK(add_string(cd, data, "length", &length_address), "failed to add constant");
+
+                add_instruction(PUSH_BASE);
+                add_instruction(PUSH_ADDR);
+                uint32_t placeholder_length = create_placeholder();
+
+                add_instruction(DUP_LOC);
+                add_number(iterable_index);
+
+                add_instruction(PUSH);
+                add_number(length_address);
+
+                add_instruction(GET_FIELD);
+
+                add_instruction(CALL);
+                add_number(0);
+
+                patch_placeholder(placeholder_length);
+
+                add_instruction(DUP_LOC);
+                add_number(position_index);
+
+                add_instruction(LES);
+
+                add_instruction(JMP_NOT);
+                uint32_t placeholder_end = create_placeholder();
+
+                add_instruction(DUP_LOC);
+                add_number(position_index);
+
+                add_instruction(DUP_LOC);
+                add_number(iterable_index);
+
+                add_instruction(INDEX_GET);
+
+                add_instruction(CHANGE_LOC);
+                add_number(element_index);
+
+                add_instruction(PUSH_NUM);
+                add_number(1);
+
+                add_instruction(DUP_LOC);
+                add_number(position_index);
+
+                add_instruction(ADD);
+
+                add_instruction(CHANGE_LOC);
+                add_number(position_index);
+
+                // body
+                patch_placeholder(placeholder_body);
+                CHECK(compile(cd, ast->right, data, current_stack_index, function_scope, current_scope + 1, ctx), "failed to compile for statement body");
+
+                add_instruction(JMP);
+                add_number(start_index);
+
+                patch_placeholder(placeholder_list_end);
+                patch_placeholder(placeholder_end);
+
+                uint32_t n_cleaned = pop_variables(current_scope, cd);
+                for (uint32_t i = 0; i < n_cleaned; ++i) {
+                    add_instruction(POP);
+                }
+
+                *current_stack_index -= n_cleaned;
+
+                return 0;
+            }
+
         case NODE_CONSTANT:
             {
                 const char* var_name = ast->token.value;
@@ -461,22 +903,12 @@ int compile(struct compiler_data* cd, struct node* ast, struct binary_data* data
             }
         case NODE_ASSIGN:
             {
-                int32_t placeholder;
-                if (ast->left->type == NODE_INDEX) {
-                    add_instruction(PUSH_BASE);
-                    add_instruction(PUSH_ADDR);
-                    placeholder = create_placeholder();
-                }
-
                 // first compile value to assign
                 CHECK(compile(cd, ast->right, data, current_stack_index, function_scope, current_scope, ctx), "failed to compile assignment value");
 
                 // then compile the lvalue
                 CHECK(compile_lvalue(cd, ast->left, data, current_stack_index, function_scope, current_scope, ctx), "failed to compile lvalue");
 
-                if (ast->left->type == NODE_INDEX) {
-                    patch_placeholder(placeholder);
-                }
                 return 0;
             }
         case NODE_STATEMENT:
@@ -496,6 +928,8 @@ int compile(struct compiler_data* cd, struct node* ast, struct binary_data* data
                     add_instruction(POP);
                 }
 
+                *current_stack_index -= n_cleaned;
+
                 return 0;
             }
         case NODE_NOT:
@@ -530,7 +964,7 @@ int compile(struct compiler_data* cd, struct node* ast, struct binary_data* data
                 CHECK(compile(cd, ast->right, data, current_stack_index, function_scope, current_scope, cls.obj_value), "failed to compile class methods");
 
                 int32_t out_address;
-                add_constant(data, &cls, &out_address);
+                CHECK(add_constant(data, &cls, &out_address), "failed to add constant");
 
                 add_instruction(PUSH);
                 add_number(out_address);
@@ -546,6 +980,11 @@ int compile(struct compiler_data* cd, struct node* ast, struct binary_data* data
                 compile(cd, ast->right, data, current_stack_index, function_scope, current_scope, ctx);
 
                 struct sylk_object_class* current_class = ctx;
+                if (current_class->n_members >= SYLK_MAX_MEMBERS) {
+                    ERROR("class has more than %d members", SYLK_MAX_MEMBERS);
+                    return 1;
+                }
+
                 current_class->members[current_class->n_members++] = ast->token.value;
 
                 return 0;
@@ -561,102 +1000,50 @@ int compile(struct compiler_data* cd, struct node* ast, struct binary_data* data
 
         case NODE_METHOD:
             {
-                add_instruction(JMP);
-                uint32_t placeholder = create_placeholder();
-
                 struct sylk_object_class* current_class = ctx;
 
-                int32_t method_address = data->n_program_bytes;
-
-                uint32_t new_stack_index = 0;
-
-                struct node* parameter = ast->left;
-                uint32_t n_parameters = 0;
-                while (parameter) {
-                    add_variable(parameter->token.value, current_scope + 1, new_stack_index++, false, cd);
-                    parameter = parameter->right;
-                    ++n_parameters;
-                }
-
-                add_variable("self", current_scope + 1, new_stack_index++, true, cd);
-                ++n_parameters;
-
-                CHECK(compile(cd, ast->right, data, &new_stack_index, function_scope + 1, current_scope, ctx), "failed to compile function body");
+                // the body is compiled in its own chunk and the stub is patched when it is linked
+                int32_t id;
+                CHECK(add_lazy_function(cd, ast, function_scope, current_scope, &id), "failed to add method");
 
                 current_class->methods[current_class->n_methods++] = (struct sylk_named_function){
                     .name = ast->token.value,
                     .function = {
                         .type = SYLK_USER,
-                        .index = method_address,
-                        .n_parameters = n_parameters
+                        .index = lazy_index(id),
+                        .n_parameters = count_parameters(ast) + 1
                     }
                 };
 
                 if (strcmp(ast->token.value, "constructor") == 0) {
                     current_class->constructor = current_class->n_methods - 1;
-
-                    add_instruction(DUP_LOC);
-                    add_number(n_parameters - 1);
-                } else {
-                    add_instruction(PUSH_FALSE);
                 }
 
-                add_instruction(RET);
-                patch_placeholder(placeholder);
-
                 return 0;
             }
 
         case NODE_FUNCTION:
             {
-                uint32_t n_parameters = 0;
+                const char* fun_name = ast->token.value;
+                add_variable(fun_name, current_scope, *current_stack_index, false, cd);
+                increment_index();
 
-                struct node* parameter = ast->left;
-                while (parameter) {
-                    parameter = parameter->right;
-                    ++n_parameters;
-                }
+                // the body is compiled in its own chunk and the stub is patched when it is linked
+                int32_t id;
+                CHECK(add_lazy_function(cd, ast, function_scope, current_scope, &id), "failed to add function");
 
-                const char* fun_name = ast->token.value;
-                struct sylk_object o = {
-                    .type = SYLK_OBJ_FUNCTION,
-                    .obj_value = &(struct sylk_object_function) {
-                        .type = SYLK_USER,
-                        .n_parameters = n_parameters,
-                        .index = data->n_program_bytes + sizeof(int32_t) + sizeof(int32_t) + 2
-                   }
+                struct sylk_object_function function = {
+                    .type = SYLK_USER,
+                    .n_parameters = count_parameters(ast),
+                    .index = lazy_index(id)
                 };
 
                 int32_t out_address;
-                add_constant(data, &o, &out_address);
+                CHECK(add_constant(data, &(struct sylk_object){.type = SYLK_OBJ_FUNCTION, .obj_value = &function}, &out_address), "failed to add constant");
 
                 add_instruction(PUSH);
                 add_number(out_address);
 
-                add_variable(fun_name, current_scope, *current_stack_index, false, cd);
-                increment_index();
-
-                add_instruction(JMP);
-                uint32_t placeholder = create_placeholder();
-
-                uint32_t new_stack_index = 0;
-                parameter = ast->left;
-                while (parameter) {
-                    --n_parameters;
-                    add_variable(parameter->token.value, current_scope + 1, new_stack_index++, false, cd);
-
-                    parameter = parameter->right;
-                }
-
-                add_variable("self", current_scope + 1, new_stack_index++, true, cd);
-                ++n_parameters;
-
-                CHECK(compile(cd, ast->right, data, &new_stack_index, function_scope + 1, current_scope, ctx), "failed to compile function body");
-
-                // TODO: double ret in case of return
-                add_instruction(RET);
-                patch_placeholder(placeholder);
-
                 return 0;
             }
 
@@ -689,7 +1076,7 @@ int compile(struct compiler_data* cd, struct node* ast, struct binary_data* data
                 CHECK(compile(cd, ast->left, data, current_stack_index, function_scope, current_scope, ctx), "failed to compile left member of member access");
 
                 int32_t out_address;
-                add_constant(data, &(struct sylk_object){.type = SYLK_OBJ_STRING, .str_value = ast->token.value}, &out_address);
+                CHECK(add_string(cd, data, ast->token.value, &out_address), "failed to add constant");
 
                 add_instruction(PUSH);
                 add_number(out_address);
@@ -700,26 +1087,11 @@ int compile(struct compiler_data* cd, struct node* ast, struct binary_data* data
             }
         case NODE_INDEX:
             {
-                add_instruction(PUSH_BASE);
-                add_instruction(PUSH_ADDR);
-
-                int32_t placeholder = create_placeholder();
-
                 CHECK(compile(cd, ast->right, data, current_stack_index, function_scope, current_scope, ctx), "failed to compile left member of member index expression");
 
                 CHECK(compile(cd, ast->left, data, current_stack_index, function_scope, current_scope, ctx), "failed to compile left member of member index");
 
-                int32_t out_address;
-                add_constant(data, &(struct sylk_object){.type = SYLK_OBJ_STRING, .str_value = "__get"}, &out_address);
-                add_instruction(PUSH)
-                add_number(out_address);
-
-                add_instruction(GET_FIELD);
-
-                add_instruction(CALL);
-                add_number(1);
-
-                patch_placeholder(placeholder);
+                add_instruction(INDEX_GET);
 
                 return 0;
             }
@@ -731,7 +1103,7 @@ int compile(struct compiler_data* cd, struct node* ast, struct binary_data* data
                     CHECK(compile(cd, ast->left, data, current_stack_index, function_scope, current_scope, ctx), "failed to compile return value");
                 }
 
-                add_instruction(RET);
+                add_instruction(cd->memo ? MEMO_RET : RET);
 
                 return 0;
             }
@@ -751,33 +1123,264 @@ int compile(struct compiler_data* cd, struct node* ast, struct binary_data* data
 }
 
 
-int compile_program(struct sylk* s, struct node* ast, uint8_t* bytecodes, size_t* out_n_bytecodes, uint32_t* out_start_address) {
+// compiles the body of a function in a new chunk
+static int compile_chunk(struct lazy_table* lazy, int32_t id, struct binary_data** out_chunk) {
+    // other threads may move the table while the body is compiled
+    pthread_mutex_lock(&lazy->lock);
+    struct lazy_function function = lazy->functions[id];
+    pthread_mutex_unlock(&lazy->lock);
+
+    struct sylk* s = lazy->s;
+    struct compiler_data cd = {
+        .functions = s->builtin_functions,
+        .n_functions = s->n_builtin_functions,
+        .classes = s->builtin_classes,
+        .n_classes = s->n_builtin_classes,
+        .n_locals = function.n_locals,
+        .lazy = lazy
+    };
+
+    if (function.n_locals > 0)
+        memcpy(cd.locals, function.locals, function.n_locals * sizeof(*function.locals));
+
+    struct binary_data* chunk = calloc(1, sizeof(*chunk));
+    CHECK_MEM(chunk);
+
+    if (compile_function_body(&cd, function.ast, chunk, function.function_scope, function.current_scope, NULL) != 0) {
+        ERROR("failed to compile function %s", (char*)function.ast->token.value);
+
+        binary_data_free(chunk);
+        free(chunk);
+        return 1;
+    }
+
+    *out_chunk = chunk;
+    return 0;
+}
+
+// takes functions from the table until all of them are compiled, including the nested ones
+static void* compile_worker(void* arg) {
+    struct lazy_table* lazy = arg;
+
+    while (true) {
+        pthread_mutex_lock(&lazy->lock);
+
+        if (lazy->failed || lazy->next_function >= lazy->n_functions) {
+            pthread_mutex_unlock(&lazy->lock);
+            break;
+        }
+
+        int32_t id = lazy->next_function++;
+        pthread_mutex_unlock(&lazy->lock);
+
+        struct binary_data* chunk;
+        int res = compile_chunk(lazy, id, &chunk);
+
+        pthread_mutex_lock(&lazy->lock);
+
+        if (res == 0) {
+            lazy->functions[id].chunk = chunk;
+        } else {
+            lazy->failed = true;
+        }
+
+        pthread_mutex_unlock(&lazy->lock);
+    }
+
+    return NULL;
+}
+
+static uint32_t count_threads(const struct sylk_config* config, uint32_t n_functions) {
+    uint32_t n_threads = config->compile_threads;
+    if (n_threads == 0) {
+        long n_cores = sysconf(_SC_NPROCESSORS_ONLN);
+        n_threads = n_cores > 0 ? n_cores : 1;
+    }
+
+    uint32_t max_threads = n_functions / MIN_FUNCTIONS_PER_THREAD;
+    if (n_threads > max_threads)
+        n_threads = max_threads;
+
+    return n_threads;
+}
+
+// compiles every function of the table in parallel
+static int compile_functions(struct lazy_table* lazy) {
+    // nested functions are found only while compiling their parents
+    while (lazy->next_function < lazy->n_functions) {
+        uint32_t n_threads = count_threads(lazy->s->config, lazy->n_functions - lazy->next_function);
+
+        pthread_t threads[n_threads + 1];
+        uint32_t n_started = 0;
+
+        // the current thread works too
+        for (uint32_t i = 1; i < n_threads; ++i) {
+            if (pthread_create(&threads[n_started], NULL, compile_worker, lazy) != 0)
+                break;
+
+            ++n_started;
+        }
+
+        compile_worker(lazy);
+
+        for (uint32_t i = 0; i < n_started; ++i) {
+            pthread_join(threads[i], NULL);
+        }
+
+        if (lazy->failed)
+            return 1;
+    }
+
+    return 0;
+}
+
+// places all of the constants before all of the programs, the main program first
+static int link_program(struct binary_data* program, struct lazy_table* lazy, uint8_t* bytecodes, uint32_t capacity, uint32_t* out_n_bytecodes, uint32_t* out_start_address) {
+    uint32_t n_constants = program->n_constants_bytes;
+    uint32_t n_program = program->n_program_bytes;
+
+    for (uint32_t i = 0; i < lazy->n_functions; ++i) {
+        n_constants += lazy->functions[i].chunk->n_constants_bytes;
+        n_program += lazy->functions[i].chunk->n_program_bytes;
+    }
+
+    if (n_constants + n_program > capacity) {
+        ERROR("program does not fit in %u bytes", capacity);
+        return 1;
+    }
+
+    uint32_t start_address = n_constants;
+
+    uint32_t constants_address = 0;
+    uint32_t program_address = start_address;
+
+    place(program, bytecodes, constants_address, program_address, start_address);
+    constants_address += program->n_constants_bytes;
+    program_address += program->n_program_bytes;
+
+    for (uint32_t i = 0; i < lazy->n_functions; ++i) {
+        struct lazy_function* function = &lazy->functions[i];
+
+        place(function->chunk, bytecodes, constants_address, program_address, start_address);
+
+        function->compiled = true;
+        function->index = program_address - start_address;
+
+        constants_address += function->chunk->n_constants_bytes;
+        program_address += function->chunk->n_program_bytes;
+
+        binary_data_free(function->chunk);
+        free(function->chunk);
+        function->chunk = NULL;
+    }
+
+    // every function is linked now, so all of the stubs can be replaced
+    relocate_constants(bytecodes, n_constants, 0, lazy);
+
+    *out_n_bytecodes = program_address;
+    *out_start_address = start_address;
+    return 0;
+}
+
+static int compile_halt(struct binary_data* data) {
+    add_instruction(HALT);
+    return 0;
+}
+
+int lazy_table_init(struct lazy_table* lazy, struct sylk* s) {
+    *lazy = (struct lazy_table) {
+        .s = s
+    };
+
+    CHECK(pthread_mutex_init(&lazy->lock, NULL), "failed to create the lock of the functions table");
+    return 0;
+}
+
+int compile_program(struct sylk* s, struct node* ast, struct lazy_table* lazy, uint8_t* bytecodes, uint32_t capacity, uint32_t* out_n_bytecodes, uint32_t* out_start_address) {
     struct compiler_data cd = {
         .functions = s->builtin_functions,
         .n_functions = s->n_builtin_functions,
         .classes = s->builtin_classes,
-        .n_classes = s->n_builtin_classes
+        .n_classes = s->n_builtin_classes,
+        .lazy = lazy
     };
 
     struct binary_data d = {};
     uint32_t current_stack_index = 0;
 
-    if (compile(&cd, ast, &d, &current_stack_index, 0, -1, NULL) != 0) {
+    int res = compile(&cd, ast, &d, &current_stack_index, 0, -1, NULL);
+    if (res == 0) {
+        // function bodies are linked after the program
+        res = compile_halt(&d);
+    }
+
+    if (res != 0) {
         ERROR("failed to evaluate");
+
+        binary_data_free(&d);
         return 1;
     }
 
-    size_t n_bytecodes = 0;
-    memcpy(bytecodes, d.constants_bytes, d.n_constants_bytes);
-    n_bytecodes += d.n_constants_bytes;
+    if (s->config->lazy_compile) {
+        // lazy functions are compiled and appended on their first call
+        uint32_t n_bytecodes = 0;
+
+        int32_t program_address;
+        res = link_chunk(&d, bytecodes, capacity, &n_bytecodes, d.n_constants_bytes, &program_address);
+
+        *out_n_bytecodes = n_bytecodes;
+        *out_start_address = d.n_constants_bytes;
+    } else {
+        res = compile_functions(lazy);
+        if (res == 0)
+            res = link_program(&d, lazy, bytecodes, capacity, out_n_bytecodes, out_start_address);
+    }
+
+    binary_data_free(&d);
+
+    CHECK(res, "failed to link program");
+    return 0;
+}
+
+int compile_lazy_function(struct lazy_table* lazy, int32_t id, uint8_t* bytecodes, uint32_t capacity, uint32_t* n_bytecodes, uint32_t start_address, int32_t* out_index) {
+    struct lazy_function* function = &lazy->functions[id];
+    if (function->compiled) {
+        *out_index = function->index;
+        return 0;
+    }
 
-    uint32_t start_address = n_bytecodes;
+    struct binary_data* chunk;
+    CHECK(compile_chunk(lazy, id, &chunk), "failed to compile lazy function");
 
-    // program start address
-    memcpy(bytecodes + n_bytecodes, d.program_bytes, d.n_program_bytes);
-    n_bytecodes += d.n_program_bytes;
+    int32_t program_address;
+    int res = link_chunk(chunk, bytecodes, capacity, n_bytecodes, start_address, &program_address);
 
-    *out_n_bytecodes = n_bytecodes;
-    *out_start_address = start_address;
+    binary_data_free(chunk);
+    free(chunk);
+
+    CHECK(res, "failed to link function");
+
+    // nested functions may have moved the table
+    function = &lazy->functions[id];
+    function->compiled = true;
+    function->index = program_address;
+
+    *out_index = program_address;
     return 0;
 }
+
+void lazy_table_free(struct lazy_table* lazy) {
+    for (uint32_t i = 0; i < lazy->n_functions; ++i) {
+        free(lazy->functions[i].locals);
+
+        if (lazy->functions[i].chunk) {
+            binary_data_free(lazy->functions[i].chunk);
+            free(lazy->functions[i].chunk);
+        }
+    }
+
+    free(lazy->functions);
+    pthread_mutex_destroy(&lazy->lock);
+
+    *lazy = (struct lazy_table){};
+}
@@ -1,15 +1,65 @@
 #ifndef COMPILER_H_
 #define COMPILER_H_
 
+#include <pthread.h>
 #include <stdbool.h>
 #include <stdint.h>
 
 #include "ast.h"
 #include "objects.h"
 
+#define BYTECODE_CAPACITY (1 << 20)
+
 struct sylk_vm;
 struct sylk;
+struct lazy_function;
+
+/**
+ * functions of a program, compiled in chunks separated from the code that defines them
+ *
+ * @field s interpreter instance
+ * @field functions functions indexed by id
+ * @field n_functions functions count
+ * @field allocated functions capacity
+ * @field next_function next function to be compiled by the threads
+ * @field failed true if a function failed to compile
+ * @field n_memos memoized functions compiled so far
+ * @field lock lock of the table while the threads compile
+ */
+struct lazy_table {
+    struct sylk* s;
+
+    struct lazy_function* functions;
+    uint32_t n_functions;
+    uint32_t allocated;
+
+    uint32_t next_function;
+    bool failed;
+
+    uint32_t n_memos;
+
+    pthread_mutex_t lock;
+};
+
+int lazy_table_init(struct lazy_table* lazy, struct sylk* s);
+
+int compile_program(struct sylk* s, struct node* ast, struct lazy_table* lazy, uint8_t* bytecodes, uint32_t capacity, uint32_t* out_n_bytecodes, uint32_t* out_start_address);
+
+/**
+ * compile the body of a lazy function and link it after the existing bytecodes
+ *
+ * @param lazy lazy functions of the program
+ * @param id function id stored in the stub
+ * @param bytecodes program bytecodes
+ * @param capacity bytecodes capacity
+ * @param n_bytecodes bytecodes count, updated with the new body
+ * @param start_address program start address
+ * @param out_index address of the body relative to the start address
+ *
+ * @return success code
+ */
+int compile_lazy_function(struct lazy_table* lazy, int32_t id, uint8_t* bytecodes, uint32_t capacity, uint32_t* n_bytecodes, uint32_t start_address, int32_t* out_index);
 
-int compile_program(struct sylk* s, struct node* ast, uint8_t* bytecodes, size_t* out_n_bytecodes, uint32_t* out_start_address);
+void lazy_table_free(struct lazy_table* lazy);
 
 #endif
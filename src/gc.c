@@ -1,98 +1,876 @@
 #include "gc.h"
 
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
 #include "objects.h"
+#include "sylk_string.h"
+#include "utils.h"
 #include "vm.h"
 
-void* gc_alloc(struct sylk_vm* vm, int32_t type, size_t size) {
-    void* item = malloc(size);
-    if (!item)
-        return NULL;
+static int list_push(struct gc_list* list, struct gc_header* header) {
+    if (list->n_items >= list->allocated) {
+        size_t new_size = list->allocated ? list->allocated * 2 : 64;
+
+        struct gc_header** new_items = realloc(list->items, new_size * sizeof(*new_items));
+        CHECK_MEM(new_items);
+
+        list->items = new_items;
+        list->allocated = new_size;
+    }
+
+    list->items[list->n_items++] = header;
+    return 0;
+}
+
+static bool is_young(struct gc* gc, void* memory) {
+    uint8_t* bytes = memory;
+    return gc->nursery && bytes >= gc->nursery && bytes < gc->nursery + GC_NURSERY_SIZE;
+}
+
+// constants live in the bytecodes and are never collected
+static bool is_constant(struct sylk_vm* vm, void* memory) {
+    uint8_t* bytes = memory;
+    return bytes >= vm->bytes && bytes < vm->bytes + vm->capacity;
+}
+
+static bool is_reference(const struct sylk_object* obj) {
+    switch (obj->type) {
+        case SYLK_OBJ_STRING:
+            // small strings are stored in the object
+            return !obj->small;
+
+        case SYLK_OBJ_USER:
+        case SYLK_OBJ_FUNCTION:
+        case SYLK_OBJ_INSTANCE:
+        case GC_OBJ_INT64:
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+// objects that can refer to other objects
+static bool has_references(int32_t type) {
+    return type == SYLK_OBJ_FUNCTION || type == SYLK_OBJ_INSTANCE || type == GC_OBJ_ROPE;
+}
 
+static uint64_t now_ns(void) {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+
+    return (uint64_t)time.tv_sec * 1000000000 + time.tv_nsec;
+}
+
+static void count_freed(struct gc* gc, size_t n_objects, size_t n_bytes) {
+    struct sylk_gc_stats* stats = &gc->stats;
+
+    stats->freed_objects += n_objects;
+    stats->freed_bytes += n_bytes;
+
+    stats->live_objects = stats->allocated_objects - stats->freed_objects;
+    stats->live_bytes = stats->allocated_bytes - stats->freed_bytes;
+}
+
+// adds the duration of a phase to the statistics and reports it to the callback
+static void finish_phase(struct gc* gc, enum sylk_gc_phase phase, uint64_t duration) {
+    struct sylk_gc_stats* stats = &gc->stats;
+
+    switch (phase) {
+        case SYLK_GC_MINOR:
+            stats->minor_pause_ns += duration;
+            break;
+        case SYLK_GC_MARK_START:
+        case SYLK_GC_MARK_SLICE:
+            stats->mark_pause_ns += duration;
+            break;
+        case SYLK_GC_MARK_FINISH:
+            stats->finish_pause_ns += duration;
+            break;
+        case SYLK_GC_SWEEP:
+            stats->sweep_ns += duration;
+            break;
+    }
+
+    if (phase != SYLK_GC_SWEEP && duration > stats->max_pause_ns)
+        stats->max_pause_ns = duration;
+
+    if (gc->callback) {
+        struct sylk_gc_event event = {
+            .phase = phase,
+            .duration_ns = duration,
+            .stats = stats
+        };
+
+        gc->callback(&event, gc->callback_ctx);
+    }
+}
+
+static void remember(struct gc* gc, struct gc_header* header) {
+    if (header->remembered)
+        return;
+
+    if (list_push(&gc->remembered, header) != 0) {
+        MEMORY_ERROR();
+        abort();
+    }
+
+    header->remembered = true;
+}
+
+// marks an object of the old generation and queues it to be scanned
+static void shade(struct gc* gc, struct gc_header* header) {
+    if (header->marked)
+        return;
+
+    header->marked = true;
+
+    if (has_references(header->type) && list_push(&gc->gray, header) != 0) {
+        MEMORY_ERROR();
+        abort();
+    }
+}
+
+static struct gc_header* alloc_old(struct sylk_vm* vm, int32_t type, size_t size) {
     struct gc* gc = &vm->gc;
 
-    gc->pool[gc->n_items++] = (struct gc_item){
+    struct gc_header* header = slab_alloc(&vm->slab, sizeof(*header) + size);
+    if (!header)
+        return NULL;
+
+    *header = (struct gc_header) {
         .type = type,
-        .marked = false,
-        .memory = item
+        .size = size,
+        .next = gc->objects
     };
 
-    return item;
+    gc->objects = header;
+    ++gc->n_items;
+
+    // objects created during a marking survive it and are scanned once they are initialized
+    if (gc->marking)
+        shade(gc, header);
+
+    gc->allocated_bytes += sizeof(*header) + size;
+
+    size_t budget = gc->live_bytes * gc->growth_factor;
+    if (budget < GC_MIN_HEAP)
+        budget = GC_MIN_HEAP;
+
+    if (!gc->marking && gc->allocated_bytes > budget) {
+        gc->collect = true;
+        gc->major = true;
+    }
+
+    return header;
 }
 
-static struct gc_item* get_item(struct gc* gc, void* item) {
-    for (uint32_t i = 0; i < gc->n_items; ++i) {
-        if (gc->pool[i].memory == item)
-            return &gc->pool[i];
+static struct gc_header* alloc_young(struct gc* gc, int32_t type, size_t size) {
+    if (!gc->nursery) {
+        gc->nursery = malloc(GC_NURSERY_SIZE);
+        if (!gc->nursery)
+            return NULL;
     }
 
-    return NULL;
+    // keeps the objects aligned
+    size_t n_bytes = (sizeof(struct gc_header) + size + 7) & ~(size_t)7;
+    if (gc->nursery_top + n_bytes > GC_NURSERY_SIZE) {
+        gc->collect = true;
+        gc->minor = true;
+        return NULL;
+    }
+
+    struct gc_header* header = (struct gc_header*)(gc->nursery + gc->nursery_top);
+    gc->nursery_top += n_bytes;
+
+    *header = (struct gc_header) {
+        .type = type,
+        .size = size
+    };
+
+    return header;
 }
 
-static void mark_item(struct gc* gc, struct sylk_object* obj);
+void* gc_alloc(struct sylk_vm* vm, int32_t type, size_t size) {
+    struct gc* gc = &vm->gc;
 
-static void mark_item_cb(struct sylk_object* o, void* ctx) {
-    struct gc* gc = ctx;
-    mark_item(gc, o);
+    // the marking advances with the allocations
+    if (gc->marking) {
+        gc->slice_bytes += size;
+        if (gc->slice_bytes >= GC_SLICE_BYTES)
+            gc->collect = true;
+    }
+
+    struct sylk_gc_stats* stats = &gc->stats;
+    ++stats->allocated_objects;
+    stats->allocated_bytes += sizeof(struct gc_header) + size;
+
+    stats->live_objects = stats->allocated_objects - stats->freed_objects;
+    stats->live_bytes = stats->allocated_bytes - stats->freed_bytes;
+
+    if (stats->live_bytes > stats->heap_high_water)
+        stats->heap_high_water = stats->live_bytes;
+
+    // user objects are never moved because their memory is freed by the sweep
+    struct gc_header* header = NULL;
+    if (type != SYLK_OBJ_USER && size <= GC_MAX_YOUNG_SIZE)
+        header = alloc_young(gc, type, size);
+
+    if (header) {
+        ++gc->young_objects;
+        gc->young_bytes += sizeof(*header) + size;
+
+        return header + 1;
+    }
+
+    // objects held only by the caller are not rooted yet, so the collections wait for a safe point
+    header = alloc_old(vm, type, size);
+    if (!header)
+        return NULL;
+
+    // the object can be initialized with young objects before the next minor collection
+    if (has_references(type))
+        remember(gc, header);
+
+    return header + 1;
 }
 
-static void mark_item(struct gc* gc, struct sylk_object* obj) {
-    struct gc_item* item = get_item(gc, obj->obj_value);
-    if (!item)
+void gc_write_barrier(struct sylk_vm* vm, void* object, const struct sylk_object* value) {
+    struct gc* gc = &vm->gc;
+
+    if (!is_reference(value) || is_constant(vm, value->obj_value))
         return;
 
-    if (item->marked)
+    if (!is_young(gc, value->obj_value)) {
+        // a white object stored in a black one would never be scanned
+        if (gc->marking)
+            shade(gc, gc_header_of(value->obj_value));
+
         return;
+    }
 
-    item->marked = true;
-    switch (obj->type) {
+    if (is_young(gc, object) || is_constant(vm, object))
+        return;
+
+    remember(gc, gc_header_of(object));
+}
+
+void gc_write_barrier_value(struct sylk_vm* vm, void* object, sylk_value value) {
+    struct sylk_object o = value_gc_object(value);
+    gc_write_barrier(vm, object, &o);
+}
+
+static void free_item(struct slab_allocator* slab, struct gc_header* header) {
+    if (header->type == SYLK_OBJ_USER) {
+        struct sylk_object_user* user = (struct sylk_object_user*)(header + 1);
+        user->free_fun(user->mem);
+    }
+
+    slab_dealloc(slab, header, sizeof(*header) + header->size);
+}
+
+static void evacuate(struct sylk_vm* vm, struct sylk_object* obj);
+
+static void evacuate_cb(struct sylk_object* o, void* ctx) {
+    struct sylk_vm* vm = ctx;
+    evacuate(vm, o);
+}
+
+// calls the callback with every object referred by the object
+static void iterate_references(struct gc_header* header, sylk_object_callback cb, void* ctx) {
+    switch (header->type) {
         case SYLK_OBJ_INSTANCE:
             {
-                struct sylk_object_instance* instance = item->memory;
+                struct sylk_object_instance* instance = (struct sylk_object_instance*)(header + 1);
                 struct sylk_object_class* cls = instance->cls;
 
                 for (uint32_t i = 0; i < cls->n_members; ++i) {
-                    mark_item(gc, &instance->members[i]);
+                    value_visit(&instance->members[i], cb, ctx);
                 }
 
                 if (cls->iterate_fun) {
-                    cls->iterate_fun(instance, mark_item_cb, gc);
+                    cls->iterate_fun(instance, cb, ctx);
                 }
+            }
+            break;
+
+        case SYLK_OBJ_FUNCTION:
+            {
+                // bound methods keep their instance alive
+                struct sylk_object_function* function = (struct sylk_object_function*)(header + 1);
+                cb(&function->context, ctx);
+            }
+            break;
 
+        case GC_OBJ_ROPE:
+            {
+                struct sylk_rope* rope = rope_of(header + 1);
+                cb(&rope->left, ctx);
+                cb(&rope->right, ctx);
             }
             break;
     }
 }
 
-void gc_clean(struct sylk_vm* vm) {
+// copies a young object in the old generation and updates the reference
+static void evacuate(struct sylk_vm* vm, struct sylk_object* obj) {
     struct gc* gc = &vm->gc;
-    if (gc->n_items < gc->treshold)
+
+    if (!is_reference(obj) || !is_young(gc, obj->obj_value))
         return;
 
+    struct gc_header* header = gc_header_of(obj->obj_value);
+    if (!header->forwarded) {
+        struct gc_header* promoted = alloc_old(vm, header->type, header->size);
+        if (!promoted) {
+            MEMORY_ERROR();
+            abort();
+        }
+
+        memcpy(promoted + 1, header + 1, header->size);
+
+        ++gc->stats.promoted_objects;
+        gc->stats.promoted_bytes += sizeof(*header) + header->size;
+
+        --gc->young_objects;
+        gc->young_bytes -= sizeof(*header) + header->size;
+
+        header->forwarded = true;
+        header->next = promoted;
+
+        if (has_references(promoted->type) && list_push(&gc->promoted, promoted) != 0) {
+            MEMORY_ERROR();
+            abort();
+        }
+    }
+
+    obj->obj_value = header->next + 1;
+}
+
+// moves the live objects of the nursery in the old generation
+static void collect_young(struct sylk_vm* vm) {
+    struct gc* gc = &vm->gc;
+
     for (uint32_t i = 0; i < vm->stack_size; ++i) {
-        mark_item(gc, &vm->stack[i]);
+        value_visit(&vm->stack[i], evacuate_cb, vm);
+    }
+
+    memo_iterate(&vm->memos, evacuate_cb, vm);
+
+    for (size_t i = 0; i < gc->remembered.n_items; ++i) {
+        struct gc_header* header = gc->remembered.items[i];
+        header->remembered = false;
+
+        iterate_references(header, evacuate_cb, vm);
+    }
+
+    gc->remembered.n_items = 0;
+
+    while (gc->promoted.n_items > 0) {
+        struct gc_header* header = gc->promoted.items[--gc->promoted.n_items];
+        iterate_references(header, evacuate_cb, vm);
     }
 
-    uint32_t i = 0;
-    while (i < gc->n_items) {
-        while (i < gc->n_items && !gc->pool[i].marked) {
-            printf("deleting memory\n");
+    // every survivor was copied, so the nursery is empty again
+    gc->nursery_top = 0;
+
+    count_freed(gc, gc->young_objects, gc->young_bytes);
+    gc->young_objects = 0;
+    gc->young_bytes = 0;
+
+    ++gc->stats.n_minor;
+}
+
+static void mark_item(struct sylk_vm* vm, struct sylk_object* obj) {
+    if (!is_reference(obj))
+        return;
+
+    // young objects are found by the minor collection that ends the marking
+    if (!obj->obj_value || is_constant(vm, obj->obj_value) || is_young(&vm->gc, obj->obj_value))
+        return;
+
+    shade(&vm->gc, gc_header_of(obj->obj_value));
+}
+
+static void mark_item_cb(struct sylk_object* o, void* ctx) {
+    struct sylk_vm* vm = ctx;
+    mark_item(vm, o);
+}
+
+static void mark_roots(struct sylk_vm* vm) {
+    for (uint32_t i = 0; i < vm->stack_size; ++i) {
+        struct sylk_object o = value_gc_object(vm->stack[i]);
+        mark_item(vm, &o);
+    }
+
+    // cached results stay alive as long as they are in the cache
+    memo_iterate(&vm->memos, mark_item_cb, vm);
+}
+
+// scans at most "budget" gray objects, returns true if none is left
+static bool mark_gray(struct sylk_vm* vm, size_t budget) {
+    struct gc* gc = &vm->gc;
+
+    while (gc->gray.n_items > 0 && budget > 0) {
+        struct gc_header* header = gc->gray.items[--gc->gray.n_items];
+        iterate_references(header, mark_item_cb, vm);
+
+        --budget;
+    }
+
+    return gc->gray.n_items == 0;
+}
+
+/**
+ * gray objects of a marking thread, the owner works at the bottom and the other
+ * threads steal from the top
+ *
+ * @field lock lock of the deque
+ * @field items gray objects
+ * @field top index of the oldest object
+ * @field bottom index after the newest object
+ * @field allocated items capacity
+ */
+struct mark_deque {
+    pthread_mutex_t lock;
+
+    struct gc_header** items;
+    size_t top;
+    size_t bottom;
+    size_t allocated;
+};
+
+/**
+ * @field vm virtual machine
+ * @field deques one deque for every thread
+ * @field n_threads threads count
+ * @field pending gray objects that were not scanned yet, the marking ends when it is 0
+ */
+struct parallel_mark {
+    struct sylk_vm* vm;
+
+    struct mark_deque* deques;
+    uint32_t n_threads;
+
+    atomic_size_t pending;
+};
 
-            struct gc_item* item = &gc->pool[i];
-            if (item->type == SYLK_OBJ_USER) {
-                struct sylk_object_user* user = item->memory;
-                user->free_fun(user->mem);
+/**
+ * @field mark shared state of the marking
+ * @field id index of the deque of the thread
+ */
+struct mark_worker {
+    struct parallel_mark* mark;
+    uint32_t id;
+};
+
+static void deque_push(struct mark_deque* deque, struct gc_header* header) {
+    pthread_mutex_lock(&deque->lock);
+
+    if (deque->bottom >= deque->allocated) {
+        // reuse the room left by the stolen objects before growing
+        if (deque->top > 0) {
+            memmove(deque->items, deque->items + deque->top, (deque->bottom - deque->top) * sizeof(*deque->items));
+            deque->bottom -= deque->top;
+            deque->top = 0;
+        }
+
+        if (deque->bottom >= deque->allocated) {
+            size_t new_size = deque->allocated ? deque->allocated * 2 : 256;
+
+            struct gc_header** new_items = realloc(deque->items, new_size * sizeof(*new_items));
+            if (!new_items) {
+                MEMORY_ERROR();
+                abort();
             }
 
-            free(item->memory);
-            *item = gc->pool[--gc->n_items];
+            deque->items = new_items;
+            deque->allocated = new_size;
+        }
+    }
+
+    deque->items[deque->bottom++] = header;
+
+    pthread_mutex_unlock(&deque->lock);
+}
+
+static struct gc_header* deque_pop(struct mark_deque* deque) {
+    pthread_mutex_lock(&deque->lock);
+
+    struct gc_header* header = NULL;
+    if (deque->bottom > deque->top)
+        header = deque->items[--deque->bottom];
+
+    pthread_mutex_unlock(&deque->lock);
+    return header;
+}
+
+static struct gc_header* deque_steal(struct mark_deque* deque) {
+    pthread_mutex_lock(&deque->lock);
+
+    struct gc_header* header = NULL;
+    if (deque->bottom > deque->top)
+        header = deque->items[deque->top++];
+
+    pthread_mutex_unlock(&deque->lock);
+    return header;
+}
+
+static void mark_item_parallel(struct sylk_object* obj, void* ctx) {
+    struct mark_worker* worker = ctx;
+    struct parallel_mark* mark = worker->mark;
+    struct sylk_vm* vm = mark->vm;
+
+    if (!is_reference(obj))
+        return;
+
+    if (!obj->obj_value || is_constant(vm, obj->obj_value) || is_young(&vm->gc, obj->obj_value))
+        return;
+
+    // only the thread that sets the bit scans the object
+    struct gc_header* header = gc_header_of(obj->obj_value);
+    if (atomic_exchange(&header->marked, true))
+        return;
+
+    if (!has_references(header->type))
+        return;
+
+    atomic_fetch_add(&mark->pending, 1);
+    deque_push(&mark->deques[worker->id], header);
+}
+
+static void* mark_worker(void* arg) {
+    struct mark_worker* worker = arg;
+    struct parallel_mark* mark = worker->mark;
+
+    while (atomic_load(&mark->pending) > 0) {
+        struct gc_header* header = deque_pop(&mark->deques[worker->id]);
+
+        for (uint32_t i = 1; !header && i < mark->n_threads; ++i) {
+            header = deque_steal(&mark->deques[(worker->id + i) % mark->n_threads]);
         }
 
-        if (i < gc->n_items) {
-            gc->pool[i].marked = false;
+        // the remaining objects are being scanned by other threads
+        if (!header) {
+            sched_yield();
+            continue;
         }
 
-        ++i;
+        iterate_references(header, mark_item_parallel, worker);
+        atomic_fetch_sub(&mark->pending, 1);
     }
+
+    return NULL;
+}
+
+// scans all of the gray objects on the gc threads
+static void mark_gray_parallel(struct sylk_vm* vm) {
+    struct gc* gc = &vm->gc;
+    uint32_t n_threads = gc->n_threads;
+
+    struct mark_deque deques[n_threads];
+    struct mark_worker workers[n_threads];
+    pthread_t threads[n_threads];
+
+    struct parallel_mark mark = {
+        .vm = vm,
+        .deques = deques,
+        .n_threads = n_threads
+    };
+
+    for (uint32_t i = 0; i < n_threads; ++i) {
+        deques[i] = (struct mark_deque){};
+        pthread_mutex_init(&deques[i].lock, NULL);
+
+        workers[i] = (struct mark_worker) {
+            .mark = &mark,
+            .id = i
+        };
+    }
+
+    atomic_store(&mark.pending, gc->gray.n_items);
+    for (size_t i = 0; i < gc->gray.n_items; ++i) {
+        deque_push(&deques[i % n_threads], gc->gray.items[i]);
+    }
+
+    gc->gray.n_items = 0;
+
+    // the current thread works too
+    uint32_t n_started = 1;
+    while (n_started < n_threads && pthread_create(&threads[n_started], NULL, mark_worker, &workers[n_started]) == 0) {
+        ++n_started;
+    }
+
+    // objects of the threads that failed to start can be stolen
+    mark_worker(&workers[0]);
+
+    for (uint32_t i = 1; i < n_started; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+
+    for (uint32_t i = 0; i < n_threads; ++i) {
+        pthread_mutex_destroy(&deques[i].lock);
+        free(deques[i].items);
+    }
+}
+
+static void mark_all_gray(struct sylk_vm* vm) {
+    if (vm->gc.n_threads > 1) {
+        mark_gray_parallel(vm);
+        return;
+    }
+
+    mark_gray(vm, SIZE_MAX);
+}
+
+// frees the objects that were not marked and clears the marks of the others
+static void* sweep(void* arg) {
+    struct sylk_vm* vm = arg;
+    struct gc* gc = &vm->gc;
+
+    uint64_t start = now_ns();
+
+    size_t n_swept = 0;
+    size_t swept_bytes = 0;
+
+    struct gc_header* survivors = NULL;
+    struct gc_header* last = NULL;
+    size_t n_survivors = 0;
+    size_t live_bytes = 0;
+
+    struct gc_header* header = gc->sweeping;
+    while (header) {
+        struct gc_header* next = header->next;
+
+        if (header->marked) {
+            header->marked = false;
+            header->next = survivors;
+
+            if (!survivors)
+                last = header;
+
+            survivors = header;
+            ++n_survivors;
+            live_bytes += sizeof(*header) + header->size;
+        } else {
+            ++n_swept;
+            swept_bytes += sizeof(*header) + header->size;
+
+            free_item(&vm->slab, header);
+        }
+
+        header = next;
+    }
+
+    gc->sweeping = NULL;
+
+    gc->survivors = survivors;
+    gc->last_survivor = last;
+    gc->n_survivors = n_survivors;
+    gc->survivors_bytes = live_bytes;
+
+    gc->n_swept = n_swept;
+    gc->swept_bytes = swept_bytes;
+    gc->sweep_ns = now_ns() - start;
+
+    atomic_store(&gc->sweep_done, true);
+    return NULL;
+}
+
+// gives the objects that survived the sweep back to the old generation
+static void merge_survivors(struct gc* gc) {
+    if (gc->survivors) {
+        gc->last_survivor->next = gc->objects;
+        gc->objects = gc->survivors;
+    }
+
+    gc->n_items += gc->n_survivors;
+    gc->live_bytes = gc->survivors_bytes;
+
+    gc->survivors = NULL;
+    gc->last_survivor = NULL;
+
+    count_freed(gc, gc->n_swept, gc->swept_bytes);
+    finish_phase(gc, SYLK_GC_SWEEP, gc->sweep_ns);
+}
+
+// waits for the sweeper, without waiting the survivors are merged only if it is done
+static void finish_sweep(struct sylk_vm* vm, bool wait) {
+    struct gc* gc = &vm->gc;
+
+    if (!gc->sweeper_running)
+        return;
+
+    if (!wait && !atomic_load(&gc->sweep_done))
+        return;
+
+    pthread_join(gc->sweeper, NULL);
+    gc->sweeper_running = false;
+
+    merge_survivors(gc);
+}
+
+// hands the old generation to the sweeper thread, the interpreter keeps allocating in a new list
+static void start_sweep(struct sylk_vm* vm) {
+    struct gc* gc = &vm->gc;
+
+    // dead objects are freed by the sweeper, so they must not be scanned by the next minor collection
+    size_t n_remembered = 0;
+    for (size_t i = 0; i < gc->remembered.n_items; ++i) {
+        struct gc_header* header = gc->remembered.items[i];
+        if (header->marked)
+            gc->remembered.items[n_remembered++] = header;
+    }
+
+    gc->remembered.n_items = n_remembered;
+
+    gc->sweeping = gc->objects;
+    gc->objects = NULL;
+    gc->n_items = 0;
+    gc->allocated_bytes = 0;
+
+    atomic_store(&gc->sweep_done, false);
+    gc->sweeper_running = true;
+
+    if (pthread_create(&gc->sweeper, NULL, sweep, vm) != 0) {
+        // without a thread the interpreter sweeps in this pause
+        gc->sweeper_running = false;
+
+        sweep(vm);
+        merge_survivors(gc);
+    }
+}
+
+static void start_marking(struct sylk_vm* vm) {
+    struct gc* gc = &vm->gc;
+
+    // the marks of the previous collection must be cleared
+    finish_sweep(vm, true);
+
+    gc->marking = true;
+    gc->slice_bytes = 0;
+
+    mark_roots(vm);
+
+    ++gc->stats.n_major;
+}
+
+static void finish_marking(struct sylk_vm* vm) {
+    struct gc* gc = &vm->gc;
+
+    // the roots may refer to objects that are still white
+    mark_roots(vm);
+    mark_all_gray(vm);
+
+    gc->marking = false;
+    start_sweep(vm);
+}
+
+// every collection of the nursery is reported as its own phase, also the ones a major collection needs
+static void minor_collection(struct sylk_vm* vm) {
+    uint64_t start = now_ns();
+    collect_young(vm);
+
+    finish_phase(&vm->gc, SYLK_GC_MINOR, now_ns() - start);
+}
+
+void gc_clean(struct sylk_vm* vm) {
+    struct gc* gc = &vm->gc;
+
+    finish_sweep(vm, false);
+
+    if (gc->minor) {
+        minor_collection(vm);
+        gc->minor = false;
+    }
+
+    uint64_t start = now_ns();
+
+    if (gc->marking) {
+        gc->slice_bytes = 0;
+        ++gc->stats.n_slices;
+
+        bool done = mark_gray(vm, gc->mark_budget);
+
+        uint64_t end = now_ns();
+        finish_phase(gc, SYLK_GC_MARK_SLICE, end - start);
+        start = end;
+
+        if (done) {
+            // the young objects may refer to objects that are still white
+            minor_collection(vm);
+
+            start = now_ns();
+            finish_marking(vm);
+            finish_phase(gc, SYLK_GC_MARK_FINISH, now_ns() - start);
+        }
+    } else if (gc->major) {
+        // the marking starts with an empty nursery
+        minor_collection(vm);
+
+        start = now_ns();
+        start_marking(vm);
+
+        uint64_t end = now_ns();
+        finish_phase(gc, SYLK_GC_MARK_START, end - start);
+        start = end;
+
+        // without a budget the whole collection is done in this pause, nothing was allocated in the nursery since the marking started
+        if (gc->mark_budget == 0) {
+            finish_marking(vm);
+            finish_phase(gc, SYLK_GC_MARK_FINISH, now_ns() - start);
+        }
+
+        gc->major = false;
+    }
+
+    gc->collect = false;
+}
+
+void gc_free(struct sylk_vm* vm) {
+    struct gc* gc = &vm->gc;
+
+    finish_sweep(vm, true);
+
+    struct gc_header* header = gc->objects;
+    while (header) {
+        struct gc_header* next = header->next;
+        free_item(&vm->slab, header);
+        header = next;
+    }
+
+    free(gc->nursery);
+    free(gc->remembered.items);
+    free(gc->promoted.items);
+    free(gc->gray.items);
+
+    // the statistics are read after the program ends
+    struct sylk_gc_stats stats = gc->stats;
+    *gc = (struct gc){
+        .stats = stats
+    };
+}
+
+void* gc_alloc_immortal(int32_t type, size_t size) {
+    struct gc_header* header = malloc(sizeof(*header) + size);
+    if (!header)
+        return NULL;
+
+    // a marked object is never shaded, scanned or swept
+    *header = (struct gc_header) {
+        .type = type,
+        .marked = true,
+        .size = size
+    };
+
+    return header + 1;
+}
+
+void gc_free_immortal(void* mem) {
+    free(gc_header_of(mem));
 }
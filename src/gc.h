@@ -1,24 +1,218 @@
 #ifndef GC_H_
 #define GC_H_
 
+#include <pthread.h>
+#include <stdatomic.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
 
-struct gc_item {
-    bool marked;
+#include "sylk.h"
+
+/**
+ * header placed in front of every object allocated by the gc
+ *
+ * @field type object type, should be a value of sylk_object_type
+ * @field marked true if the object was reached in the current collection, atomic for the parallel marking
+ * @field remembered true if the object is in the remembered set
+ * @field forwarded true if the object was moved out of the nursery
+ * @field size size of the object without the header
+ * @field next next object of the old generation or the new location of a forwarded object
+ */
+struct gc_header {
     int32_t type;
-    void* memory;
+    atomic_bool marked;
+    bool remembered;
+    bool forwarded;
+    size_t size;
+
+    struct gc_header* next;
 };
 
+// header of an object allocated with "gc_alloc"
+#define gc_header_of(memory) \
+    ((struct gc_header*)(memory) - 1)
+
+// collections of the old generation never run while it is smaller than this
+#define GC_MIN_HEAP (1 << 20)
+
+#define GC_DEFAULT_GROWTH_FACTOR 1.0f
+
+#define GC_NURSERY_SIZE (1 << 20)
+
+// bigger objects are allocated directly in the old generation
+#define GC_MAX_YOUNG_SIZE (GC_NURSERY_SIZE / 16)
+
+// header type of the ropes, they are SYLK_OBJ_STRING values that refer to other strings
+#define GC_OBJ_ROPE SYLK_OBJ_COUNT
+
+// header type of the integers too big for a value, see "value.h"
+#define GC_OBJ_INT64 (SYLK_OBJ_COUNT + 1)
+
+// bytes allocated between two slices of an incremental marking
+#define GC_SLICE_BYTES (1 << 15)
+
+/**
+ * growable array of object headers
+ *
+ * @field items headers
+ * @field n_items headers count
+ * @field allocated headers capacity
+ */
+struct gc_list {
+    struct gc_header** items;
+    size_t n_items;
+    size_t allocated;
+};
+
+/**
+ * generational heap, new objects are bump allocated in the nursery and the ones that
+ * survive a minor collection are copied in the old generation
+ *
+ * the old generation is marked with three colors: white objects are not marked, gray
+ * objects are marked and waiting in the gray list, black objects are marked and scanned
+ *
+ * @field objects objects of the old generation, linked through their headers
+ * @field n_items objects count of the old generation
+ * @field nursery memory of the young generation
+ * @field nursery_top bytes used in the nursery
+ * @field remembered old objects that may refer to young objects
+ * @field promoted objects copied in the current minor collection and not scanned yet
+ * @field gray marked objects of the old generation that were not scanned yet
+ * @field live_bytes bytes of the old generation that survived the last major collection
+ * @field allocated_bytes bytes added to the old generation since the last major collection
+ * @field growth_factor allocated bytes, relative to the live ones, that start a major collection
+ * @field mark_budget objects scanned by every slice of an incremental marking, 0 to mark in a single pause
+ * @field n_threads threads marking the heap at the end of a collection
+ * @field slice_bytes bytes allocated since the last slice of the marking
+ * @field collect true if the gc has work to do at the next safe point
+ * @field minor true if the nursery is full
+ * @field major true if the old generation should be collected
+ * @field marking true while an incremental marking is in progress
+ * @field sweeping objects of the last major collection that the sweeper did not visit yet
+ * @field sweeper thread that frees the dead objects of the last major collection
+ * @field sweeper_running true until the sweeper is joined
+ * @field sweep_done set by the sweeper when the survivors are ready
+ * @field survivors objects that survived the sweep, linked through their headers
+ * @field last_survivor last object of the survivors
+ * @field n_survivors survivors count
+ * @field survivors_bytes bytes of the survivors
+ * @field n_swept objects freed by the sweeper
+ * @field swept_bytes bytes freed by the sweeper
+ * @field sweep_ns time spent by the sweeper
+ * @field young_objects objects allocated in the nursery since the last minor collection and not promoted
+ * @field young_bytes bytes of the young objects
+ * @field stats statistics of the collections
+ * @field callback function called after every phase of a collection
+ * @field callback_ctx context passed to the callback
+ */
 struct gc {
-    struct gc_item pool[300];
+    struct gc_header* objects;
     size_t n_items;
-    size_t treshold;
+
+    uint8_t* nursery;
+    size_t nursery_top;
+
+    struct gc_list remembered;
+    struct gc_list promoted;
+    struct gc_list gray;
+
+    size_t live_bytes;
+    size_t allocated_bytes;
+    float growth_factor;
+
+    uint32_t mark_budget;
+    size_t slice_bytes;
+
+    uint32_t n_threads;
+
+    bool collect;
+    bool minor;
+    bool major;
+    bool marking;
+
+    struct gc_header* sweeping;
+    pthread_t sweeper;
+    bool sweeper_running;
+    atomic_bool sweep_done;
+
+    struct gc_header* survivors;
+    struct gc_header* last_survivor;
+    size_t n_survivors;
+    size_t survivors_bytes;
+
+    size_t n_swept;
+    size_t swept_bytes;
+    uint64_t sweep_ns;
+
+    size_t young_objects;
+    size_t young_bytes;
+
+    struct sylk_gc_stats stats;
+    sylk_gc_callback callback;
+    void* callback_ctx;
 };
 
 struct sylk_vm;
+struct sylk_object;
 
+/**
+ * allocate an object managed by the gc, the allocation never collects but it can
+ * request a collection that runs at the next safe point of the interpreter
+ *
+ * @param vm virtual machine
+ * @param type object type
+ * @param size object size
+ *
+ * @return object memory or NULL on failure
+ */
 void* gc_alloc(struct sylk_vm* vm, int32_t type, size_t size);
+
+/**
+ * record a store of a value inside an object, must be called after every store in a
+ * heap object so the minor collections can find the young objects referred by old ones
+ * and the incremental marking never misses an object stored in a scanned one
+ *
+ * @param vm virtual machine
+ * @param object memory of the object that was changed
+ * @param value stored value
+ */
+void gc_write_barrier(struct sylk_vm* vm, void* object, const struct sylk_object* value);
+
+/**
+ * record a store of a value inside an object, like "gc_write_barrier"
+ *
+ * @param vm virtual machine
+ * @param object memory of the object that was changed
+ * @param value stored value
+ */
+void gc_write_barrier_value(struct sylk_vm* vm, void* object, sylk_value value);
+
+/**
+ * do the work requested by the allocations, must be called only when every live object
+ * is reachable from the roots
+ *
+ * @param vm virtual machine
+ */
 void gc_clean(struct sylk_vm* vm);
+void gc_free(struct sylk_vm* vm);
+
+/**
+ * allocate an object that is never collected, it can be shared by many virtual machines
+ * because it is created marked and never joins a generation
+ *
+ * @param type object type
+ * @param size object size
+ *
+ * @return object memory or NULL on failure
+ */
+void* gc_alloc_immortal(int32_t type, size_t size);
+
+/**
+ * free an object allocated with "gc_alloc_immortal"
+ *
+ * @param mem object memory
+ */
+void gc_free_immortal(void* mem);
 
 #endif
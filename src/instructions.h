@@ -32,7 +32,13 @@ enum instructions {
     PUSH_NUM   = 27,
     GET_FIELD  = 28,
     SET_FIELD  = 29,
-    IMPORT     = 30
+    IMPORT     = 30,
+    FOR_ITER   = 31,
+    INDEX_GET  = 32,
+    INDEX_SET  = 33,
+    MEMO_GET   = 34,
+    MEMO_RET   = 35,
+    HALT       = 36
 };
 
 #endif
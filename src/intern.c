@@ -0,0 +1,102 @@
+#include "intern.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "gc.h"
+#include "sylk_string.h"
+#include "utils.h"
+
+#define MIN_ENTRIES 64
+
+static struct sylk_string** find_slot(struct sylk_string** entries, uint32_t allocated, uint32_t hash, const char* chars, uint32_t length) {
+    uint32_t index = hash & (allocated - 1);
+
+    while (entries[index]) {
+        struct sylk_string* string = entries[index];
+        if (string->hash == hash && string->length == length && memcmp(string->data, chars, length) == 0)
+            break;
+
+        index = (index + 1) & (allocated - 1);
+    }
+
+    return &entries[index];
+}
+
+static int grow(struct intern_table* table) {
+    uint32_t new_size = table->allocated ? table->allocated * 2 : MIN_ENTRIES;
+
+    struct sylk_string** new_entries = calloc(new_size, sizeof(*new_entries));
+    CHECK_MEM(new_entries);
+
+    for (uint32_t i = 0; i < table->allocated; ++i) {
+        struct sylk_string* string = table->entries[i];
+        if (string)
+            *find_slot(new_entries, new_size, string->hash, string->data, string->length) = string;
+    }
+
+    free(table->entries);
+
+    table->entries = new_entries;
+    table->allocated = new_size;
+
+    return 0;
+}
+
+int intern_init(struct intern_table* table) {
+    *table = (struct intern_table){};
+
+    CHECK(pthread_mutex_init(&table->lock, NULL), "failed to create the lock of the intern table");
+    return 0;
+}
+
+struct sylk_string* intern(struct intern_table* table, const char* chars, uint32_t length) {
+    uint32_t hash = hash_chars(chars, length);
+
+    pthread_mutex_lock(&table->lock);
+
+    // the table is kept at most half full
+    if ((table->n_entries + 1) * 2 > table->allocated && grow(table) != 0) {
+        pthread_mutex_unlock(&table->lock);
+        return NULL;
+    }
+
+    struct sylk_string** slot = find_slot(table->entries, table->allocated, hash, chars, length);
+    if (!*slot) {
+        struct sylk_string* string = gc_alloc_immortal(SYLK_OBJ_STRING, sylk_string_size(length));
+        if (!string) {
+            pthread_mutex_unlock(&table->lock);
+            MEMORY_ERROR();
+            return NULL;
+        }
+
+        *string = (struct sylk_string) {
+            .length = length,
+            .hash = hash,
+            .interned = true
+        };
+
+        memcpy(string->data, chars, length);
+        string->data[length] = '\0';
+
+        *slot = string;
+        ++table->n_entries;
+    }
+
+    struct sylk_string* string = *slot;
+
+    pthread_mutex_unlock(&table->lock);
+    return string;
+}
+
+void intern_free(struct intern_table* table) {
+    for (uint32_t i = 0; i < table->allocated; ++i) {
+        if (table->entries[i])
+            gc_free_immortal(table->entries[i]);
+    }
+
+    free(table->entries);
+    pthread_mutex_destroy(&table->lock);
+
+    *table = (struct intern_table){};
+}
@@ -0,0 +1,54 @@
+#ifndef INTERN_H_
+#define INTERN_H_
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include "objects.h"
+
+/**
+ * set of unique strings shared by the lexer, the compiler and the virtual machine, two
+ * interned strings are equal only if they are the same object
+ *
+ * @field entries open addressing table of strings
+ * @field n_entries strings count
+ * @field allocated table capacity, always a power of two
+ * @field lock protects the table from the compiler threads
+ */
+struct intern_table {
+    struct sylk_string** entries;
+    uint32_t n_entries;
+    uint32_t allocated;
+
+    pthread_mutex_t lock;
+};
+
+/**
+ * initialize an empty table
+ *
+ * @param table intern table
+ *
+ * @return success code
+ */
+int intern_init(struct intern_table* table);
+
+/**
+ * get the unique string with the given characters, it is created if it doesn't exist,
+ * the string is never collected and lives until the table is freed
+ *
+ * @param table intern table
+ * @param chars characters, they don't need a terminator
+ * @param length characters count
+ *
+ * @return interned string or NULL on failure
+ */
+struct sylk_string* intern(struct intern_table* table, const char* chars, uint32_t length);
+
+/**
+ * free the table and all of its strings
+ *
+ * @param table intern table
+ */
+void intern_free(struct intern_table* table);
+
+#endif
@@ -3,11 +3,13 @@
 #include <stdlib.h>
 #include <string.h>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 #include "lexer.h"
 #include "utils.h"
 
-#define CHUNK_SIZE 512
-
 #define in_range(character, start, stop) \
     ((character) >= (start) && (character) <= (stop))
 
@@ -23,58 +25,126 @@
 #define advance() \
     (++l->current_index);
 
-static int tokenize_int(struct lexer* l, struct token* out_token) {
-    int final_number = 0;
-    int8_t sign = 1;
+// integers have 64 bits, a '.' followed by a digit makes the number a double
+static int tokenize_number(struct lexer* l, struct token* out_token) {
+    size_t start = l->current_index;
+    bool negative = false;
 
     if (current_char() == '-') {
-        sign = -1;
+        negative = true;
         advance();
     }
 
+    uint64_t magnitude = 0;
+    bool overflow = false;
 
     while(!is_end() && in_range(current_char(), '0', '9')) {
-        final_number = final_number * 10 + current_char() - '0';
+        uint32_t digit = current_char() - '0';
+
+        if (magnitude > (UINT64_MAX - digit) / 10) {
+            overflow = true;
+        } else {
+            magnitude = magnitude * 10 + digit;
+        }
+
         advance();
     }
 
-    final_number = sign * final_number;
+    if (!is_last() && current_char() == '.' && in_range(l->text[l->current_index + 1], '0', '9')) {
+        advance();
+
+        while (!is_end() && in_range(current_char(), '0', '9')) {
+            advance();
+        }
 
-    int* token_value = malloc(sizeof(*token_value));
-    CHECK_MEM(token_value);
+        // the text is not terminated, so the number is copied for strtod
+        char buffer[64];
+        size_t length = l->current_index - start;
+        if (length >= sizeof(buffer)) {
+            ERROR("number is too long");
+            return 1;
+        }
 
-    *token_value = final_number;
+        memcpy(buffer, &l->text[start], length);
+        buffer[length] = '\0';
+
+        out_token->code = TOK_FLT;
+        out_token->float_value = strtod(buffer, NULL);
+
+        return 0;
+    }
+
+    // the smallest integer is one further from 0 than the biggest one
+    uint64_t limit = negative ? (uint64_t)INT64_MAX + 1 : (uint64_t)INT64_MAX;
+    if (overflow || magnitude > limit) {
+        ERROR("integer is too big");
+        return 1;
+    }
 
     out_token->code = TOK_INT;
-    out_token->value = token_value;
+    out_token->int_value = negative ? (int64_t)(0 - magnitude) : (int64_t)magnitude;
 
     return 0;
 }
 
+/*
+ * the scanners return the index of the first character that ends a run, or the size of
+ * the text, the runs are classified 16 characters at a time where SSE2 is available
+ */
+
+static size_t scan_to(const char* text, size_t index, size_t size, char character) {
+    // memchr is already vectorized by the C library
+    const char* found = memchr(&text[index], character, size - index);
+    return found ? (size_t)(found - text) : size;
+}
+
+static bool is_blank(char character) {
+    return character == ' ' || character == '\t' || character == '\r';
+}
+
+static size_t scan_blanks(const char* text, size_t index, size_t size) {
+#ifdef __SSE2__
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i carriage_return = _mm_set1_epi8('\r');
+
+    for (; index + 16 <= size; index += 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i*)&text[index]);
+        __m128i blank = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, space), _mm_cmpeq_epi8(chunk, tab)), _mm_cmpeq_epi8(chunk, carriage_return));
+
+        uint32_t others = ~(uint32_t)_mm_movemask_epi8(blank) & 0xffff;
+        if (others)
+            return index + __builtin_ctz(others);
+    }
+#endif
+
+    while (index < size && is_blank(text[index])) {
+        ++index;
+    }
+
+    return index;
+}
+
 // TODO: parse special characters like \n
 static int tokenize_string(struct lexer* l, struct token* out_token) {
     char start_quote = current_char();
     advance();
 
-    char* value = malloc(CHUNK_SIZE);
-    CHECK_MEM(value);
+    size_t start = l->current_index;
 
-    uint32_t value_index = 0;
+    l->current_index = scan_to(l->text, start, l->text_size, start_quote);
 
-    while (!is_end() && current_char() != start_quote) {
-        value[value_index++] = l->text[l->current_index++];
-    }
-
-    if (is_end() || current_char() != start_quote) {
+    if (is_end()) {
         ERROR("Expected closing quote on string");
         return 1;
     }
 
-    advance();
-    value[value_index++] = '\0';
-
+    // the quotes are not part of the text
     out_token->code = TOK_STR;
-    out_token->value = value;
+    out_token->offset = start;
+    out_token->length = l->current_index - start;
+
+    advance();
 
     return 0;
 }
@@ -95,57 +165,104 @@ static bool is_iden(char character) {
     return is_iden_first(character) || in_range(character, '0', '9');
 }
 
-static bool check_keyword(const char* text, int* out_token_code) {
-    static const struct {
-        const char* name;
-        int token;
-    } keywords[] = {
-        {.name = "if",     .token = TOK_IF},
-        {.name = "else",   .token = TOK_ELS},
-        {.name = "while",  .token = TOK_WHL},
-        {.name = "def",    .token = TOK_FUN},
-        {.name = "return", .token = TOK_RET},
-        {.name = "true",   .token = TOK_TRU},
-        {.name = "false",  .token = TOK_FAL},
-        {.name = "var",    .token = TOK_VAR},
-        {.name = "class",  .token = TOK_CLS},
-        {.name = "const",  .token = TOK_CON},
-        {.name = "export", .token = TOK_EXP},
-        {.name = "import", .token = TOK_IMP},
-    };
-
-    for (unsigned int i = 0; i < sizeof(keywords) / sizeof(keywords[0]); ++i) {
-        if (strcmp(text, keywords[i].name) == 0) {
-            *out_token_code = keywords[i].token;
-            return true;
-        }
+#define match_keyword(name, token_code) \
+    if (memcmp(text, name, length) == 0) { \
+        *out_token_code = token_code; \
+        return true; \
+    } \
+    break;
+
+// the length and one character select the only keyword the identifier can be
+static bool check_keyword(const char* text, size_t length, int* out_token_code) {
+    switch (length) {
+        case 2:
+            switch (text[1]) {
+                case 'f': match_keyword("if", TOK_IF);
+                case 'n': match_keyword("in", TOK_IN);
+            }
+            break;
+        case 3:
+            switch (text[0]) {
+                case 'd': match_keyword("def", TOK_FUN);
+                case 'v': match_keyword("var", TOK_VAR);
+                case 'f': match_keyword("for", TOK_FOR);
+            }
+            break;
+        case 4:
+            switch (text[0]) {
+                case 'e': match_keyword("else", TOK_ELS);
+                case 't': match_keyword("true", TOK_TRU);
+                case 'm': match_keyword("memo", TOK_MEM);
+            }
+            break;
+        case 5:
+            switch (text[2]) {
+                case 'i': match_keyword("while", TOK_WHL);
+                case 'l': match_keyword("false", TOK_FAL);
+                case 'a': match_keyword("class", TOK_CLS);
+                case 'n': match_keyword("const", TOK_CON);
+            }
+            break;
+        case 6:
+            switch (text[0]) {
+                case 'r': match_keyword("return", TOK_RET);
+                case 'e': match_keyword("export", TOK_EXP);
+                case 'i': match_keyword("import", TOK_IMP);
+            }
+            break;
     }
 
     return false;
 }
 
-static int tokenize_identifier(struct lexer* l, struct token* out_token) {
-    char* value = malloc(CHUNK_SIZE);
-    CHECK_MEM(value);
-
-    uint32_t value_index = 0;
+#undef match_keyword
+
+static size_t scan_identifier(const char* text, size_t index, size_t size) {
+#ifdef __SSE2__
+    // the comparisons are signed, so the characters above 127 are never in a range
+    const __m128i case_bit = _mm_set1_epi8(0x20);
+    const __m128i before_a = _mm_set1_epi8('a' - 1);
+    const __m128i after_z = _mm_set1_epi8('z' + 1);
+    const __m128i before_0 = _mm_set1_epi8('0' - 1);
+    const __m128i after_9 = _mm_set1_epi8('9' + 1);
+    const __m128i underscore = _mm_set1_epi8('_');
+
+    for (; index + 16 <= size; index += 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i*)&text[index]);
+
+        // setting the case bit maps the upper case letters to the lower case ones
+        __m128i lower = _mm_or_si128(chunk, case_bit);
+        __m128i letter = _mm_and_si128(_mm_cmpgt_epi8(lower, before_a), _mm_cmplt_epi8(lower, after_z));
+        __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(chunk, before_0), _mm_cmplt_epi8(chunk, after_9));
+        __m128i iden = _mm_or_si128(_mm_or_si128(letter, digit), _mm_cmpeq_epi8(chunk, underscore));
+
+        uint32_t others = ~(uint32_t)_mm_movemask_epi8(iden) & 0xffff;
+        if (others)
+            return index + __builtin_ctz(others);
+    }
+#endif
 
-    while (!is_end() && is_iden(current_char())) {
-        value[value_index++] = current_char();
-        advance();
+    while (index < size && is_iden(text[index])) {
+        ++index;
     }
 
-    value[value_index++] = '\0';
+    return index;
+}
+
+static int tokenize_identifier(struct lexer* l, struct token* out_token) {
+    size_t start = l->current_index;
+
+    l->current_index = scan_identifier(l->text, start, l->text_size);
+
+    size_t length = l->current_index - start;
 
     int token_code;
-    if (check_keyword(value, &token_code)) {
-        free(value);
+    if (check_keyword(&l->text[start], length, &token_code)) {
         out_token->code = token_code;
         return 0;
     }
 
     out_token->code = TOK_IDN;
-    out_token->value = value;
 
     return 0;
 }
@@ -158,9 +275,7 @@ static int tokenize_identifier(struct lexer* l, struct token* out_token) {
     (l->text[l->current_index + 1])
 
 void go_next_line(struct lexer* l) {
-    while (!is_end() && current_char() != '\n') {
-        advance();
-    }
+    l->current_index = scan_to(l->text, l->current_index, l->text_size, '\n');
 }
 
 int get_token(struct lexer* l, struct token* out_token) {
@@ -170,15 +285,22 @@ int get_token(struct lexer* l, struct token* out_token) {
                 go_next_line(l);
             case '\n':
                 l->line += 1;
+                advance();
+                continue;
             case ' ':
             case '\r':
             case '\t':
-                advance();
+                l->current_index = scan_blanks(l->text, l->current_index, l->text_size);
                 continue;
         }
         break;
     }
 
+    *out_token = (struct token) {
+        .offset = l->current_index,
+        .line = l->line
+    };
+
     if (is_end()) {
         out_token->code = TOK_EOF;
         return 0;
@@ -193,7 +315,7 @@ int get_token(struct lexer* l, struct token* out_token) {
             break;
         case '-':
             if (!is_last() && in_range(next_character(), '0', '9')) {
-                CHECK(tokenize_int(l, out_token), "failed to tokenize int");
+                CHECK(tokenize_number(l, out_token), "failed to tokenize number");
             } else {
                 set_token(TOK_MIN);
             }
@@ -280,7 +402,7 @@ int get_token(struct lexer* l, struct token* out_token) {
             break;
         default:
             if (in_range(current_character, '0', '9')) {
-                CHECK(tokenize_int(l, out_token), "failed to tokenize int");
+                CHECK(tokenize_number(l, out_token), "failed to tokenize number");
 
             } else if (current_character == '\"' || current_character == '\'') {
                 CHECK(tokenize_string(l, out_token), "failed to tokenize string");
@@ -296,6 +418,10 @@ int get_token(struct lexer* l, struct token* out_token) {
             break;
     }
 
+    // strings set their text without the quotes
+    if (out_token->code != TOK_STR)
+        out_token->length = l->current_index - start_index;
+
     out_token->index = start_index;
     return 0;
 }
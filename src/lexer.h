@@ -43,14 +43,28 @@ enum token_codes {
     TOK_CLS = 35,
     TOK_CON = 36,
     TOK_EXP = 37,
-    TOK_IMP = 38
+    TOK_IMP = 38,
+    TOK_FOR = 39,
+    TOK_IN  = 40,
+    TOK_MEM = 41,
+    TOK_FLT = 42  // floating point number (2.5)
 };
 
+/*
+ * the text of a token is a slice of the source, nothing is allocated by the lexer,
+ * the parser interns the text of the identifiers and strings it keeps
+ */
 struct token {
-    int code;     // token enum
-    void* value;  // associated value ( for integer and string ) otherwise NULL
-    int line;     // line from text
-    int index;    // index from text
+    int code;         // token enum
+    uint32_t offset;  // start of the text in the source, after the quote for strings
+    uint32_t length;  // characters count of the text
+    union {
+        int64_t int_value;   // value of an integer
+        double float_value;  // value of a floating point number
+        const char* value;   // text of an identifier or a string once the parser keeps it, otherwise NULL
+    };
+    int line;         // line from text
+    int index;        // index from text
 };
 
 struct lexer {
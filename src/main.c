@@ -10,12 +10,14 @@
 
 #define print_help() \
 { \
-    printf("usage: %s <file_name> [-a] [-b] [-h]\n", argv[0]); \
+    printf("usage: %s <file_name> [-a] [-b] [-h] [-l] [-g]\n", argv[0]); \
     printf("help:\n"); \
     printf("\t<file_name> : file with code to execute\n"); \
     printf("\t-a          : dump the abstract syntax tree\n"); \
     printf("\t-b          : dump the generated bytecodes\n"); \
     printf("\t-h          : not execute the program\n"); \
+    printf("\t-l          : compile functions on their first call\n"); \
+    printf("\t-g          : print the gc statistics at exit\n"); \
 }
 
 int main(int argc, char* argv[]) {
@@ -27,6 +29,8 @@ int main(int argc, char* argv[]) {
     bool print_ast = false;
     bool print_bytecode = false;
     bool halt_program = false;
+    bool lazy_compile = false;
+    bool gc_print_stats = false;
 
     // parse flags
     int index = 2;
@@ -54,6 +58,14 @@ int main(int argc, char* argv[]) {
             case 'h':
                 halt_program = true;
                 break;
+
+            case 'l':
+                lazy_compile = true;
+                break;
+
+            case 'g':
+                gc_print_stats = true;
+                break;
             default:
                 print_help();
                 return 1;
@@ -65,7 +77,9 @@ int main(int argc, char* argv[]) {
     struct sylk_config config = {
         .print_ast = print_ast,
         .print_bytecode = print_bytecode,
-        .halt_program = halt_program
+        .halt_program = halt_program,
+        .lazy_compile = lazy_compile,
+        .gc_print_stats = gc_print_stats
     };
 
     struct sylk* s = sylk_new(&config, NULL);
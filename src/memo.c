@@ -0,0 +1,377 @@
+#include "memo.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "sylk_string.h"
+#include "utils.h"
+#include "value.h"
+
+#define MIN_BUCKETS 16
+
+static uint32_t hash_bytes(uint32_t hash, const void* bytes, size_t n_bytes) {
+    const uint8_t* b = bytes;
+    for (size_t i = 0; i < n_bytes; ++i) {
+        hash = (hash ^ b[i]) * 16777619u;
+    }
+
+    return hash;
+}
+
+// only numbers, bools and strings are hashed by value
+static bool hash_args(const sylk_value* args, uint32_t n_args, uint32_t* out_hash) {
+    uint32_t hash = 2166136261u;
+
+    for (uint32_t i = 0; i < n_args; ++i) {
+        struct sylk_object object = value_unbox(args[i]);
+        const struct sylk_object* arg = &object;
+        hash = hash_bytes(hash, &arg->type, sizeof(arg->type));
+
+        switch (arg->type) {
+            case SYLK_OBJ_NUMBER:
+                hash = hash_bytes(hash, &arg->num_value, sizeof(arg->num_value));
+                break;
+            case SYLK_OBJ_FLOAT:
+                {
+                    // 0.0 and -0.0 are equal, so they must have the same hash
+                    double number = arg->float_value == 0 ? 0 : arg->float_value;
+                    hash = hash_bytes(hash, &number, sizeof(number));
+                }
+                break;
+            case SYLK_OBJ_BOOL:
+                hash = hash_bytes(hash, &arg->bool_value, sizeof(arg->bool_value));
+                break;
+            case SYLK_OBJ_STRING:
+                {
+                    // small strings hash the same as the allocated ones
+                    uint32_t string_hash_value = arg->small ? hash_chars(arg->small_value, arg->small_length) : string_hash(arg->str_value);
+                    hash = hash_bytes(hash, &string_hash_value, sizeof(string_hash_value));
+                }
+                break;
+            default:
+                return false;
+        }
+    }
+
+    *out_hash = hash;
+    return true;
+}
+
+static bool equal_arg(const struct sylk_object* arg1, const struct sylk_object* arg2) {
+    if (arg1->type != arg2->type)
+        return false;
+
+    switch (arg1->type) {
+        case SYLK_OBJ_NUMBER:
+            return arg1->num_value == arg2->num_value;
+        case SYLK_OBJ_FLOAT:
+            return arg1->float_value == arg2->float_value;
+        case SYLK_OBJ_BOOL:
+            return arg1->bool_value == arg2->bool_value;
+        case SYLK_OBJ_STRING:
+            {
+                uint32_t length = string_length(arg1);
+                return length == string_length(arg2) && memcmp(string_flat_chars(arg1), string_flat_chars(arg2), length) == 0;
+            }
+    }
+
+    return true;
+}
+
+// the key is compared with another key, or with the arguments on the stack if "other_key" is NULL
+static bool equal_args(const struct sylk_object* key, const struct sylk_object* other_key, const sylk_value* args, uint32_t n_args) {
+    for (uint32_t i = 0; i < n_args; ++i) {
+        struct sylk_object arg = other_key ? other_key[i] : value_unbox(args[i]);
+
+        if (!equal_arg(&key[i], &arg))
+            return false;
+    }
+
+    return true;
+}
+
+// key of the functions without arguments, a NULL key means the arguments can't be hashed
+static struct sylk_object empty_key[1];
+
+static void free_key(struct sylk_object* key, uint32_t n_args) {
+    if (key == empty_key)
+        return;
+
+    for (uint32_t i = 0; i < n_args; ++i) {
+        if (key[i].type == SYLK_OBJ_STRING && !key[i].small && !key[i].str_value->interned)
+            free(key[i].str_value);
+    }
+
+    free(key);
+}
+
+// strings are copied because the arguments may be collected before the entry, except the small and interned ones
+static struct sylk_object* copy_key(const sylk_value* args, uint32_t n_args) {
+    if (n_args == 0)
+        return empty_key;
+
+    struct sylk_object* key = malloc(n_args * sizeof(*key));
+    if (!key)
+        return NULL;
+
+    for (uint32_t i = 0; i < n_args; ++i) {
+        key[i] = value_unbox(args[i]);
+
+        if (key[i].type == SYLK_OBJ_STRING && !key[i].small && !key[i].str_value->interned) {
+            const struct sylk_string* string = key[i].str_value;
+            size_t size = sylk_string_size(string->length);
+
+            key[i].str_value = malloc(size);
+            if (!key[i].str_value) {
+                free_key(key, i);
+                return NULL;
+            }
+
+            memcpy(key[i].str_value, string, size);
+        }
+    }
+
+    return key;
+}
+
+static void unlink_entry(struct memo_cache* cache, struct memo_entry* entry) {
+    if (entry->newer) {
+        entry->newer->older = entry->older;
+    } else {
+        cache->newest = entry->older;
+    }
+
+    if (entry->older) {
+        entry->older->newer = entry->newer;
+    } else {
+        cache->oldest = entry->newer;
+    }
+
+    entry->newer = NULL;
+    entry->older = NULL;
+}
+
+static void push_newest(struct memo_cache* cache, struct memo_entry* entry) {
+    entry->older = cache->newest;
+    entry->newer = NULL;
+
+    if (cache->newest) {
+        cache->newest->newer = entry;
+    } else {
+        cache->oldest = entry;
+    }
+
+    cache->newest = entry;
+}
+
+static struct memo_entry* find_entry(struct memo_cache* cache, uint32_t hash, const struct sylk_object* key, const sylk_value* args) {
+    struct memo_entry* entry = cache->buckets[hash & (cache->n_buckets - 1)];
+    while (entry) {
+        if (entry->hash == hash && equal_args(entry->key, key, args, cache->n_args))
+            return entry;
+
+        entry = entry->next;
+    }
+
+    return NULL;
+}
+
+static void evict_oldest(struct memo_cache* cache) {
+    struct memo_entry* entry = cache->oldest;
+    unlink_entry(cache, entry);
+
+    struct memo_entry** link = &cache->buckets[entry->hash & (cache->n_buckets - 1)];
+    while (*link != entry) {
+        link = &(*link)->next;
+    }
+
+    *link = entry->next;
+
+    free_key(entry->key, cache->n_args);
+    free(entry);
+
+    --cache->n_entries;
+}
+
+// doubles the buckets, the cache keeps working with the old ones if the allocation fails
+static void grow_buckets(struct memo_cache* cache) {
+    uint32_t n_buckets = cache->n_buckets * 2;
+
+    struct memo_entry** buckets = calloc(n_buckets, sizeof(*buckets));
+    if (!buckets)
+        return;
+
+    for (struct memo_entry* entry = cache->newest; entry; entry = entry->older) {
+        uint32_t bucket = entry->hash & (n_buckets - 1);
+
+        entry->next = buckets[bucket];
+        buckets[bucket] = entry;
+    }
+
+    free(cache->buckets);
+
+    cache->buckets = buckets;
+    cache->n_buckets = n_buckets;
+}
+
+static struct memo_cache* get_cache(struct memo_table* table, uint32_t index, uint32_t capacity, uint32_t n_args) {
+    if (index >= table->n_caches) {
+        struct memo_cache* new_caches = realloc(table->caches, (index + 1) * sizeof(*new_caches));
+        if (!new_caches)
+            return NULL;
+
+        memset(&new_caches[table->n_caches], 0, (index + 1 - table->n_caches) * sizeof(*new_caches));
+
+        table->caches = new_caches;
+        table->n_caches = index + 1;
+    }
+
+    struct memo_cache* cache = &table->caches[index];
+    if (cache->buckets)
+        return cache;
+
+    // the table starts small and grows with the entries
+    cache->buckets = calloc(MIN_BUCKETS, sizeof(*cache->buckets));
+    if (!cache->buckets)
+        return NULL;
+
+    cache->n_buckets = MIN_BUCKETS;
+    cache->capacity = capacity < MEMO_MAX_CAPACITY ? capacity : MEMO_MAX_CAPACITY;
+    cache->n_args = n_args;
+
+    return cache;
+}
+
+static int push_pending(struct memo_table* table, struct memo_pending pending) {
+    if (table->n_pending >= table->allocated_pending) {
+        uint32_t new_size = table->allocated_pending ? table->allocated_pending * 2 : MIN_BUCKETS;
+
+        struct memo_pending* new_pending = realloc(table->pending, new_size * sizeof(*new_pending));
+        CHECK_MEM(new_pending);
+
+        table->pending = new_pending;
+        table->allocated_pending = new_size;
+    }
+
+    table->pending[table->n_pending++] = pending;
+    return 0;
+}
+
+int memo_lookup(struct memo_table* table, uint32_t cache_index, uint32_t capacity, const sylk_value* args, uint32_t n_args, bool* out_hit, struct sylk_object* out_value) {
+    struct memo_cache* cache = get_cache(table, cache_index, capacity, n_args);
+    CHECK_MEM(cache);
+
+    *out_hit = false;
+
+    struct memo_pending pending = {
+        .cache = cache_index
+    };
+
+    if (hash_args(args, n_args, &pending.hash)) {
+        struct memo_entry* entry = find_entry(cache, pending.hash, NULL, args);
+        if (entry) {
+            unlink_entry(cache, entry);
+            push_newest(cache, entry);
+
+            *out_hit = true;
+            *out_value = entry->value;
+            return 0;
+        }
+
+        pending.key = copy_key(args, n_args);
+        CHECK_MEM(pending.key);
+    }
+
+    CHECK(push_pending(table, pending), "failed to add pending call");
+    return 0;
+}
+
+int memo_store(struct memo_table* table, const struct sylk_object* value) {
+    if (table->n_pending == 0) {
+        ERROR("no memoized call in progress");
+        return 1;
+    }
+
+    struct memo_pending pending = table->pending[--table->n_pending];
+
+    // arguments that can't be hashed are never cached
+    if (!pending.key)
+        return 0;
+
+    struct memo_cache* cache = &table->caches[pending.cache];
+
+    // a recursive call may have already stored the same arguments
+    struct memo_entry* entry = find_entry(cache, pending.hash, pending.key, NULL);
+    if (entry) {
+        free_key(pending.key, cache->n_args);
+        entry->value = *value;
+        return 0;
+    }
+
+    if (cache->n_entries >= cache->capacity) {
+        evict_oldest(cache);
+    } else if (cache->n_entries >= cache->n_buckets) {
+        grow_buckets(cache);
+    }
+
+    entry = malloc(sizeof(*entry));
+    if (!entry) {
+        free_key(pending.key, cache->n_args);
+        MEMORY_ERROR();
+        return 1;
+    }
+
+    uint32_t bucket = pending.hash & (cache->n_buckets - 1);
+
+    *entry = (struct memo_entry) {
+        .hash = pending.hash,
+        .key = pending.key,
+        .value = *value,
+        .next = cache->buckets[bucket]
+    };
+
+    cache->buckets[bucket] = entry;
+    push_newest(cache, entry);
+    ++cache->n_entries;
+
+    return 0;
+}
+
+void memo_iterate(struct memo_table* table, sylk_object_callback cb, void* ctx) {
+    for (uint32_t i = 0; i < table->n_caches; ++i) {
+        struct memo_entry* entry = table->caches[i].newest;
+        while (entry) {
+            cb(&entry->value, ctx);
+            entry = entry->older;
+        }
+    }
+}
+
+void memo_free(struct memo_table* table) {
+    for (uint32_t i = 0; i < table->n_caches; ++i) {
+        struct memo_cache* cache = &table->caches[i];
+
+        struct memo_entry* entry = cache->newest;
+        while (entry) {
+            struct memo_entry* older = entry->older;
+
+            free_key(entry->key, cache->n_args);
+            free(entry);
+
+            entry = older;
+        }
+
+        free(cache->buckets);
+    }
+
+    for (uint32_t i = 0; i < table->n_pending; ++i) {
+        struct memo_pending* pending = &table->pending[i];
+        if (pending->key)
+            free_key(pending->key, table->caches[pending->cache].n_args);
+    }
+
+    free(table->caches);
+    free(table->pending);
+
+    *table = (struct memo_table){};
+}
@@ -0,0 +1,132 @@
+#ifndef MEMO_H_
+#define MEMO_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "objects.h"
+
+#define MEMO_DEFAULT_CAPACITY 1024
+
+// bigger sizes are clamped, so the buckets count never overflows
+#define MEMO_MAX_CAPACITY (1u << 24)
+
+/**
+ * cached result of a memoized function
+ *
+ * @field hash hash of the arguments
+ * @field key copy of the arguments
+ * @field value returned value
+ * @field next next entry in the same bucket
+ * @field newer more recently used entry
+ * @field older less recently used entry
+ */
+struct memo_entry {
+    uint32_t hash;
+    struct sylk_object* key;
+    struct sylk_object value;
+
+    struct memo_entry* next;
+
+    struct memo_entry* newer;
+    struct memo_entry* older;
+};
+
+/**
+ * least recently used cache of a memoized function
+ *
+ * @field buckets hash table buckets
+ * @field n_buckets buckets count
+ * @field n_args arguments count of the function
+ * @field n_entries cached results count
+ * @field capacity maximum number of cached results, at most MEMO_MAX_CAPACITY
+ * @field newest most recently used entry
+ * @field oldest least recently used entry, the first to be evicted
+ */
+struct memo_cache {
+    struct memo_entry** buckets;
+    uint32_t n_buckets;
+
+    uint32_t n_args;
+
+    uint32_t n_entries;
+    uint32_t capacity;
+
+    struct memo_entry* newest;
+    struct memo_entry* oldest;
+};
+
+/**
+ * call that missed the cache and waits for the function to return
+ *
+ * @field cache index of the cache
+ * @field hash hash of the arguments
+ * @field key copy of the arguments or NULL if they can't be cached
+ */
+struct memo_pending {
+    uint32_t cache;
+    uint32_t hash;
+    struct sylk_object* key;
+};
+
+/**
+ * caches of all of the memoized functions of a program
+ *
+ * @field caches caches indexed by the id given by the compiler
+ * @field n_caches caches count
+ * @field pending calls in progress, innermost last
+ * @field n_pending pending calls count
+ * @field allocated_pending pending calls capacity
+ */
+struct memo_table {
+    struct memo_cache* caches;
+    uint32_t n_caches;
+
+    struct memo_pending* pending;
+    uint32_t n_pending;
+    uint32_t allocated_pending;
+};
+
+/**
+ * look up the arguments of a memoized call, on a miss the call is
+ * remembered until its result is stored with "memo_store"
+ *
+ * @param table memo table
+ * @param cache cache index
+ * @param capacity maximum cached results if the cache is created now
+ * @param args call arguments on the stack
+ * @param n_args arguments count
+ * @param out_hit set to true if the result was cached
+ * @param out_value cached value on a hit
+ *
+ * @return success code
+ */
+int memo_lookup(struct memo_table* table, uint32_t cache, uint32_t capacity, const sylk_value* args, uint32_t n_args, bool* out_hit, struct sylk_object* out_value);
+
+/**
+ * store the result of the innermost pending call
+ *
+ * @param table memo table
+ * @param value returned value
+ *
+ * @return success code
+ */
+int memo_store(struct memo_table* table, const struct sylk_object* value);
+
+/**
+ * call the callback with every cached value
+ *
+ * @param table memo table
+ * @param cb callback
+ * @param ctx context passed to the callback
+ */
+void memo_iterate(struct memo_table* table, sylk_object_callback cb, void* ctx);
+
+/**
+ * free all of the caches
+ *
+ * @param table memo table
+ */
+void memo_free(struct memo_table* table);
+
+#endif
@@ -12,7 +12,8 @@ enum sylk_object_type {
     SYLK_OBJ_FUNCTION = 4,
     SYLK_OBJ_INSTANCE = 5,
     SYLK_OBJ_CLASS    = 6,
-    SYLK_OBJ_COUNT    = 7
+    SYLK_OBJ_FLOAT    = 7,
+    SYLK_OBJ_COUNT    = 8
 };
 
 
@@ -27,7 +28,8 @@ enum sylk_implementation_type {
 
 
 /**
- * function type for deleting an user object
+ * function type for deleting an user object, it is called on the sweeper thread of
+ * the gc so it must not use the virtual machine
  *
  * @param mem pointer to memory
  */
@@ -44,21 +46,53 @@ struct sylk_object_user {
 };
 
 
+/**
+ * immutable string, allocated by the gc or stored in the constants
+ *
+ * @field length bytes count without the terminator
+ * @field hash hash of the bytes, 0 until it is needed
+ * @field interned true if the string is the unique copy of its bytes
+ * @field rope true if the bytes are stored in other strings, see "string_flatten"
+ * @field data bytes followed by a '\0' so they can be passed to the C functions
+ */
+struct sylk_string {
+    uint32_t length;
+    uint32_t hash;
+    bool interned;
+    bool rope;
+    char data[];
+};
+
+
+// longest string stored in the object itself, it also fits in the payload of a value
+#define SYLK_SMALL_STRING_MAX 5
+
+// compact form of an object used by the stack and by the containers, see "value.h"
+typedef uint64_t sylk_value;
+
 /**
  * @field type object type, should be a value of sylk_object_type
- * @field num_value object value if object is number
- * @field str_value object value if object is string
+ * @field small true if the string is stored in "small_value" instead of "str_value"
+ * @field small_length characters count of a small string
+ * @field num_value object value if object is number, a 64 bits integer
+ * @field float_value object value if object is float
  * @field str_value object value if object is string
  * @field obj_value object value if object is an head object
+ * @field small_value characters of a small string, followed by '\0'
  */
 struct sylk_object {
     int32_t type;
 
+    bool small;
+    uint8_t small_length;
+
     union {
-        int32_t     num_value;
-        char*       str_value;
-        bool        bool_value;
-        void*       obj_value;
+        int64_t             num_value;
+        double              float_value;
+        struct sylk_string* str_value;
+        bool                bool_value;
+        void*               obj_value;
+        char                small_value[SYLK_SMALL_STRING_MAX + 1];
     };
 };
 
@@ -73,7 +107,7 @@ struct sylk_vm;
  * @param vm sylk virtual machine instance
  * @param ctx user provided context in "sylk_new"
  *
- * @return function return value to pe pushed on the stack
+ * @return function return value to pe pushed on the stack, a function that fails sets "builtin_failed" in the vm instead
  */
 typedef struct sylk_object (*builtin_fun)(struct sylk_object* self, struct sylk_vm* vm, void* ctx);
 
@@ -114,13 +148,17 @@ struct sylk_named_function {
  * structure representing an instance object
  *
  * @field cls class object
- * @field members instance members
+ * @field members instance members, allocated with the instance for the members of its class
  */
 struct sylk_object_instance {
     struct sylk_object_class* cls;
-    struct sylk_object members[256];
+    sylk_value members[];
 };
 
+// bytes of an instance of a class with "n_members" members
+#define sylk_instance_size(n_members) \
+    (sizeof(struct sylk_object_instance) + (n_members) * sizeof(sylk_value))
+
 
 typedef void (*sylk_object_callback)(struct sylk_object* o, void* ctx);
 
@@ -136,6 +174,8 @@ typedef void (*sylk_object_callback)(struct sylk_object* o, void* ctx);
 typedef void (*sylk_iterate_function)(struct sylk_object_instance* self, sylk_object_callback cb, void* ctx);
 
 
+#define SYLK_MAX_MEMBERS 10
+
 /**
  * structure representing a class object
  *
@@ -157,7 +197,7 @@ struct sylk_object_class {
 
     int32_t constructor;
 
-    const char* members[10];
+    const char* members[SYLK_MAX_MEMBERS];
     uint32_t n_members;
 
     struct sylk_named_function methods[10];
@@ -5,44 +5,45 @@
 #include "utils.h"
 #include "operations.h"
 #include "objects.h"
+#include "sylk_string.h"
 #include "vm.h"
 
 static int add_strings(struct sylk_vm* vm, struct sylk_object* op1, struct sylk_object* op2, struct sylk_object* result) {
     EXPECT_OBJECT(op2->type, SYLK_OBJ_STRING);
 
-    char* new_string = gc_alloc(vm, SYLK_OBJ_STRING, 500);
-    CHECK_MEM(new_string);
-
-    uint32_t n_new_string = 0;
-
-    strcpy(new_string, op1->str_value);
-    n_new_string += strlen(op1->str_value);
-
-    strcpy(new_string + n_new_string, op2->str_value);
-    n_new_string += strlen(op2->str_value);
-
-    *result = (struct sylk_object){.type = SYLK_OBJ_STRING, .str_value = new_string};
+    CHECK(string_concat(vm, op1, op2, result), "failed to concatenate strings");
     return 0;
 }
 
-static int add_numbers(struct sylk_vm* vm, struct sylk_object* op1, struct sylk_object* op2, struct sylk_object* result) {
-    (void)vm;
-    EXPECT_OBJECT(op2->type, SYLK_OBJ_NUMBER);
+bool is_number(const struct sylk_object* o) {
+    return o->type == SYLK_OBJ_NUMBER || o->type == SYLK_OBJ_FLOAT;
+}
 
-    *result = (struct sylk_object){.type = SYLK_OBJ_NUMBER, .num_value = op1->num_value + op2->num_value};
-    return 0;
+double number_as_float(const struct sylk_object* o) {
+    return o->type == SYLK_OBJ_FLOAT ? o->float_value : (double)o->num_value;
 }
 
+// numbers are added by the virtual machine
 operation_fun addition_table[SYLK_OBJ_COUNT] = {
-    [SYLK_OBJ_STRING] = add_strings,
-    [SYLK_OBJ_NUMBER] = add_numbers
+    [SYLK_OBJ_STRING] = add_strings
 };
 
+// an integer is equal to the double with the same value
 static int eq_numbers(struct sylk_vm* vm, struct sylk_object* op1, struct sylk_object* op2, struct sylk_object* result) {
     (void)vm;
-    EXPECT_OBJECT(op2->type, SYLK_OBJ_NUMBER);
 
-    *result = (struct sylk_object){.type = SYLK_OBJ_BOOL, .bool_value = op1->num_value == op2->num_value};
+    if (!is_number(op2)) {
+        EXPECT_OBJECT(op2->type, op1->type);
+    }
+
+    bool eq_res;
+    if (op1->type == SYLK_OBJ_NUMBER && op2->type == SYLK_OBJ_NUMBER) {
+        eq_res = op1->num_value == op2->num_value;
+    } else {
+        eq_res = number_as_float(op1) == number_as_float(op2);
+    }
+
+    *result = (struct sylk_object){.type = SYLK_OBJ_BOOL, .bool_value = eq_res};
     return 0;
 }
 
@@ -55,10 +56,10 @@ static int eq_bools(struct sylk_vm* vm, struct sylk_object* op1, struct sylk_obj
 }
 
 static int eq_strings(struct sylk_vm* vm, struct sylk_object* op1, struct sylk_object* op2, struct sylk_object* result) {
-    (void)vm;
     EXPECT_OBJECT(op2->type, SYLK_OBJ_STRING);
 
-    bool eq_res = strcmp(op1->str_value, op2->str_value) == 0;
+    bool eq_res;
+    CHECK(string_compare(vm, op1, op2, &eq_res), "failed to compare strings");
 
     *result = (struct sylk_object){.type = SYLK_OBJ_BOOL, .bool_value = eq_res};
     return 0;
@@ -66,6 +67,7 @@ static int eq_strings(struct sylk_vm* vm, struct sylk_object* op1, struct sylk_o
 
 operation_fun equality_table[SYLK_OBJ_COUNT] = {
     [SYLK_OBJ_NUMBER] = eq_numbers,
+    [SYLK_OBJ_FLOAT] = eq_numbers,
     [SYLK_OBJ_BOOL] = eq_bools,
     [SYLK_OBJ_STRING] = eq_strings
 };
@@ -79,22 +81,42 @@ operation_fun equality_table[SYLK_OBJ_COUNT] = {
     (void)pop(); \
 }
 
+// compiles the body of lazy functions on the first call
+static int resolve_function(struct sylk_vm* vm, struct sylk_object_function* function) {
+    if (function->index >= 0)
+        return 0;
+
+    int32_t index;
+    CHECK(compile_lazy_function(vm->lazy, -function->index - 1, vm->bytes, vm->capacity, &vm->n_bytes, vm->start_address, &index), "failed to compile lazy function");
+
+    function->index = index;
+    return 0;
+}
+
 static void call(struct sylk_vm* vm, int32_t index, uint32_t n_args) {
     vm->stack_base = vm->stack_size - n_args;
     vm->program_counter = vm->start_address + index - 1;
 }
 
-static int call_class(struct sylk_vm* vm, struct sylk_object* callable, int32_t n_args, void* ctx) {
-    gc_clean(vm);
+// the flag is cleared so a host can run the vm again after the error
+static int check_builtin(struct sylk_vm* vm) {
+    if (!vm->builtin_failed)
+        return 0;
+
+    vm->builtin_failed = false;
+    return 1;
+}
 
+static int call_class(struct sylk_vm* vm, struct sylk_object* callable, int32_t n_args, void* ctx) {
     struct sylk_object_class* cls = callable->obj_value;
 
-    struct sylk_object_instance* value = gc_alloc(vm, SYLK_OBJ_INSTANCE, sizeof(*value));
+    struct sylk_object_instance* value = gc_alloc(vm, SYLK_OBJ_INSTANCE, sylk_instance_size(cls->n_members));
     CHECK_MEM(value);
 
-    *value = (struct sylk_object_instance) {
-        .cls = cls
-    };
+    value->cls = cls;
+    for (uint32_t i = 0; i < cls->n_members; ++i) {
+        value->members[i] = value_from_small_int(0);
+    }
 
     struct sylk_object o = (struct sylk_object) {
         .type = SYLK_OBJ_INSTANCE,
@@ -111,6 +133,7 @@ static int call_class(struct sylk_vm* vm, struct sylk_object* callable, int32_t
 
         if (constructor) {
             constructor->function(&o, vm, ctx);
+            CHECK(check_builtin(vm), "failed to construct built-in class");
         }
 
         vm->stack_size = clean_stack_size;
@@ -121,6 +144,8 @@ static int call_class(struct sylk_vm* vm, struct sylk_object* callable, int32_t
 
     if (cls->type == SYLK_USER) {
         if(constructor) {
+            CHECK(resolve_function(vm, constructor), "failed to resolve constructor");
+
             push(o);
             call(vm, constructor->index, n_args + 1);
             return 0;
@@ -139,6 +164,8 @@ static int call_function(struct sylk_vm* vm, struct sylk_object* callable, int32
     struct sylk_object_function* function_value = callable->obj_value;
 
     if (function_value->type == SYLK_USER) {
+        CHECK(resolve_function(vm, function_value), "failed to resolve function");
+
         push(function_value->context);
         call(vm, function_value->index, n_args + 1);
         return 0;
@@ -147,6 +174,7 @@ static int call_function(struct sylk_vm* vm, struct sylk_object* callable, int32
     if (function_value->type == SYLK_BUILT_IN) {
         size_t clean_stack_size = vm->stack_size - n_args - 2;
         struct sylk_object result = function_value->function(&function_value->context, vm, ctx);
+        CHECK(check_builtin(vm), "built-in function failed");
 
         // pop_args(n_args);
 
@@ -164,20 +192,55 @@ call_fun callable_table[SYLK_OBJ_COUNT] = {
     [SYLK_OBJ_FUNCTION] = call_function,
 };
 
-static int get_instance(struct sylk_vm* vm, struct sylk_object* instance, const char* field_name) {
+int call_method(struct sylk_vm* vm, struct sylk_object* instance, const char* name, int32_t n_args, void* ctx) {
+    if (instance->type != SYLK_OBJ_INSTANCE) {
+        ERROR("object of type %s has no method %s", rev_objects[instance->type], name);
+        return 1;
+    }
+
+    struct sylk_object_instance* instance_value = instance->obj_value;
+    struct sylk_object_class* cls = instance_value->cls;
+
+    for (uint32_t i = 0; i < cls->n_methods; ++i) {
+        if (strcmp(cls->methods[i].name, name) == 0) {
+            struct sylk_object_function method = cls->methods[i].function;
+            method.context = *instance;
+
+            struct sylk_object callable = {
+                .type = SYLK_OBJ_FUNCTION,
+                .obj_value = &method
+            };
+
+            return call_function(vm, &callable, n_args, ctx);
+        }
+    }
+
+    ERROR("method: %s does not exist in class", name);
+    return 1;
+}
+
+// the names of the classes are interned, so an interned field is found by its address
+static bool is_field(const char* name, const struct sylk_string* field_name) {
+    if (field_name->interned)
+        return name == field_name->data;
+
+    return string_equal_chars(field_name, name);
+}
+
+static int get_instance(struct sylk_vm* vm, struct sylk_object* instance, const struct sylk_string* field_name) {
     struct sylk_object_instance* instance_value = instance->obj_value;
     struct sylk_object_class* cls = instance_value->cls;
 
     uint32_t i;
     for (i = 0; i < cls->n_members; ++i) {
-        if (cls->members[i] && strcmp(cls->members[i], field_name) == 0) {
-            push(instance_value->members[i]);
+        if (cls->members[i] && is_field(cls->members[i], field_name)) {
+            push_value(instance_value->members[i]);
             return 0;
         }
     }
 
     for (i = 0; i < cls->n_methods; ++i) {
-        if (strcmp(cls->methods[i].name, field_name) == 0) {
+        if (is_field(cls->methods[i].name, field_name)) {
             struct sylk_object_function method = cls->methods[i].function;
 
             struct sylk_object_function* fun = gc_alloc(vm, SYLK_OBJ_FUNCTION, sizeof(*fun));
@@ -196,7 +259,7 @@ static int get_instance(struct sylk_vm* vm, struct sylk_object* instance, const
         }
     }
 
-    ERROR("attribute: %s does not exist in class", field_name);
+    ERROR("attribute: %s does not exist in class", field_name->data);
     return 1;
 }
 
@@ -204,19 +267,20 @@ field_fun get_table[SYLK_OBJ_COUNT] = {
     [SYLK_OBJ_INSTANCE] = get_instance
 };
 
-static int set_instance(struct sylk_vm* vm, struct sylk_object* instance, const char* field_name) {
+static int set_instance(struct sylk_vm* vm, struct sylk_object* instance, const struct sylk_string* field_name) {
     struct sylk_object_instance* instance_value = instance->obj_value;
     struct sylk_object_class* cls = instance_value->cls;
 
     uint32_t i;
     for (i = 0; i < cls->n_members; ++i) {
-        if (strcmp(cls->members[i], field_name) == 0) {
-            instance_value->members[i] = pop();
+        if (is_field(cls->members[i], field_name)) {
+            instance_value->members[i] = pop_value();
+            gc_write_barrier_value(vm, instance_value, instance_value->members[i]);
             return 0;
         }
     }
 
-    ERROR("property: %s does not exist in class", field_name);
+    ERROR("property: %s does not exist in class", field_name->data);
     return 1;
 }
 
@@ -1,13 +1,33 @@
 #ifndef OPERATIONS_H_
 #define OPERATIONS_H_
+#include <stdbool.h>
 #include <stdint.h>
 
 struct sylk_vm;
 struct sylk_object;
+struct sylk_string;
 
 typedef int (*operation_fun)(struct sylk_vm* vm, struct sylk_object* op1, struct sylk_object* op2, struct sylk_object* result);
 typedef int (*call_fun)(struct sylk_vm* vm, struct sylk_object* callable, int32_t n_args, void* ctx);
-typedef int (*field_fun)(struct sylk_vm* vm, struct sylk_object* instance, const char* field_name);
+typedef int (*field_fun)(struct sylk_vm* vm, struct sylk_object* instance, const struct sylk_string* field_name);
+
+/**
+ * check if an object is an integer or a double
+ *
+ * @param o object
+ *
+ * @return true if the object is a number
+ */
+bool is_number(const struct sylk_object* o);
+
+/**
+ * get the value of a number as a double
+ *
+ * @param o integer or double object
+ *
+ * @return number value
+ */
+double number_as_float(const struct sylk_object* o);
 
 extern operation_fun addition_table[];
 extern operation_fun equality_table[];
@@ -15,4 +35,19 @@ extern call_fun callable_table[];
 extern field_fun get_table[];
 extern field_fun set_table[];
 
+/**
+ * call a method of an instance without creating a bound method object,
+ * the caller must already have pushed the stack base, the return address
+ * and the arguments
+ *
+ * @param vm virtual machine instance
+ * @param instance instance owning the method
+ * @param name method name
+ * @param n_args arguments count
+ * @param ctx user provided context
+ *
+ * @return success code
+ */
+int call_method(struct sylk_vm* vm, struct sylk_object* instance, const char* name, int32_t n_args, void* ctx);
+
 #endif
@@ -5,12 +5,13 @@
 
 #include "parser.h"
 #include "ast.h"
+#include "intern.h"
 #include "utils.h"
 #include "lexer.h"
 
 
 #define advance() \
-    get_token(parser->l, &parser->current_token)
+    next_token(parser)
 
 #define get_current_token() \
     (&parser->current_token)
@@ -29,12 +30,44 @@ struct context {
 
 static int parse_expression(struct parser* parser, struct node** root, struct context* ctx);
 
+// equal names share the same characters when they are interned
+static const char* token_text(struct parser* parser, const struct token* token) {
+    const char* start = &parser->l->text[token->offset];
+
+    if (parser->strings) {
+        struct sylk_string* string = intern(parser->strings, start, token->length);
+        return string ? string->data : NULL;
+    }
+
+    char* value = ast_arena_alloc(parser->arena, token->length + 1);
+    if (!value)
+        return NULL;
+
+    memcpy(value, start, token->length);
+    value[token->length] = '\0';
+
+    return value;
+}
+
+// only the text of the identifiers and strings is kept, the other tokens refer to the source
+static int next_token(struct parser* parser) {
+    struct token* token = &parser->current_token;
+    CHECK(get_token(parser->l, token), "failed to get token");
+
+    if (token->code == TOK_IDN || token->code == TOK_STR) {
+        token->value = token_text(parser, token);
+        CHECK_MEM(token->value);
+    }
+
+    return 0;
+}
+
 static int parse_literal(struct parser* parser, struct node** root, struct context* ctx) {
     (void)ctx;
     const struct token* current_token = get_current_token();
 
-    if (current_token->code == TOK_INT) {
-        struct node* node_num = node_new(NODE_NUMBER, current_token, NULL, NULL);
+    if (current_token->code == TOK_INT || current_token->code == TOK_FLT) {
+        struct node* node_num = node_new(parser->arena, NODE_NUMBER, current_token, NULL, NULL);
         CHECK_NODE(node_num);
 
         advance();
@@ -43,7 +76,7 @@ static int parse_literal(struct parser* parser, struct node** root, struct conte
     }
 
     if (current_token->code == TOK_TRU || current_token->code == TOK_FAL) {
-        struct node* node_bool = node_new(NODE_BOOL, current_token, NULL, NULL);
+        struct node* node_bool = node_new(parser->arena, NODE_BOOL, current_token, NULL, NULL);
         CHECK_NODE(node_bool);
 
         advance();
@@ -52,7 +85,7 @@ static int parse_literal(struct parser* parser, struct node** root, struct conte
     }
 
     if (current_token->code == TOK_STR) {
-        struct node* node_num = node_new(NODE_STRING, current_token, NULL, NULL);
+        struct node* node_num = node_new(parser->arena, NODE_STRING, current_token, NULL, NULL);
         CHECK_NODE(node_num);
 
         advance();
@@ -82,7 +115,7 @@ static int parse_primary(struct parser* parser, struct node** root, struct conte
 
 
     if (current_token->code == TOK_IDN) {
-        struct node* node_var = node_new(NODE_VAR, current_token, NULL, NULL);
+        struct node* node_var = node_new(parser->arena, NODE_VAR, current_token, NULL, NULL);
         CHECK_NODE(node_var);
 
         node_var->flags |= (LVALUE | CALLABLE);
@@ -117,7 +150,7 @@ static int parse_argument_list(struct parser* parser, struct node** root, struct
             current_token = get_current_token();
         }
 
-        arguments = node_new(NODE_ARGUMENT, NULL, argument, arguments);
+        arguments = node_new(parser->arena, NODE_ARGUMENT, NULL, argument, arguments);
         CHECK_NODE(arguments);
     }
 
@@ -137,7 +170,7 @@ static int parse_postfix(struct parser* parser, struct node** root, struct conte
         if (current_token->code == TOK_LPR && (left->flags & CALLABLE)) {
             struct node* function_parameters = NULL;
             CHECK(parse_argument_list(parser, &function_parameters, ctx), "failed to parse argument list");
-            struct node* function_node = node_new(NODE_CALL, NULL, left, function_parameters);
+            struct node* function_node = node_new(parser->arena, NODE_CALL, NULL, left, function_parameters);
             function_node->flags |= CALLABLE;
 
             left = function_node;
@@ -147,7 +180,7 @@ static int parse_postfix(struct parser* parser, struct node** root, struct conte
             current_token = get_current_token();
 
             EXPECT_TOKEN(current_token->code, TOK_IDN);
-            struct node* member_access = node_new(NODE_MEMBER_ACCESS, current_token, left, NULL);
+            struct node* member_access = node_new(parser->arena, NODE_MEMBER_ACCESS, current_token, left, NULL);
             advance();
 
             CHECK_NODE(member_access);
@@ -166,7 +199,7 @@ static int parse_postfix(struct parser* parser, struct node** root, struct conte
             EXPECT_TOKEN(current_token->code, TOK_RSQ);
             advance();
 
-            struct node* index_access = node_new(NODE_INDEX, NULL, left, expression);
+            struct node* index_access = node_new(parser->arena, NODE_INDEX, NULL, left, expression);
             CHECK_NODE(index_access);
 
             index_access->flags |= (LVALUE | CALLABLE);
@@ -191,7 +224,7 @@ static int parse_unary(struct parser* parser, struct node** root, struct context
         struct node* not_unary;
         CHECK(parse_unary(parser, &not_unary, ctx), "failed to parse unary");
 
-        struct node* not_node = node_new(NODE_NOT, NULL, not_unary, NULL);
+        struct node* not_node = node_new(parser->arena, NODE_NOT, NULL, not_unary, NULL);
         CHECK_NODE(not_node);
 
         *root = not_node;
@@ -218,7 +251,7 @@ static int parse_multiplicative(struct parser* parser, struct node** root, struc
         struct node* right;
         CHECK(parse_unary(parser, &right, ctx), "failed to parse unary");
 
-        struct node* bin_op = node_new(NODE_BINARY_OP, &operator_token, left, right);
+        struct node* bin_op = node_new(parser->arena, NODE_BINARY_OP, &operator_token, left, right);
         CHECK_NODE(bin_op);
 
         left = bin_op;
@@ -246,7 +279,7 @@ static int parse_additive(struct parser* parser, struct node** root, struct cont
         struct node* right;
         CHECK(parse_multiplicative(parser, &right, ctx), "failed to parse multiplicative");
 
-        struct node* bin_op = node_new(NODE_BINARY_OP, &operator_token, left, right);
+        struct node* bin_op = node_new(parser->arena, NODE_BINARY_OP, &operator_token, left, right);
         CHECK_NODE(bin_op);
 
         left = bin_op;
@@ -275,7 +308,7 @@ static int parse_relational(struct parser* parser, struct node** root, struct co
         struct node* right;
         CHECK(parse_additive(parser, &right, ctx), "failed to parse additive");
 
-        struct node* bin_op = node_new(NODE_BINARY_OP, &operator_token, left, right);
+        struct node* bin_op = node_new(parser->arena, NODE_BINARY_OP, &operator_token, left, right);
         CHECK_NODE(bin_op);
 
         left = bin_op;
@@ -299,7 +332,7 @@ static int parse_equality(struct parser* parser, struct node** root, struct cont
         struct node* right;
         CHECK(parse_relational(parser, &right, ctx), "failed to parse relational");
 
-        struct node* bin_op = node_new(NODE_BINARY_OP, &operator_token, left, right);
+        struct node* bin_op = node_new(parser->arena, NODE_BINARY_OP, &operator_token, left, right);
         CHECK_NODE(bin_op);
 
         left = bin_op;
@@ -323,7 +356,7 @@ static int parse_and(struct parser* parser, struct node** root, struct context*
         struct node* right;
         CHECK(parse_equality(parser, &right, ctx), "failed to parse equality");
 
-        struct node* bin_op = node_new(NODE_BINARY_OP, &operator_token, left, right);
+        struct node* bin_op = node_new(parser->arena, NODE_BINARY_OP, &operator_token, left, right);
         CHECK_NODE(bin_op);
 
         left = bin_op;
@@ -347,7 +380,7 @@ static int parse_or(struct parser* parser, struct node** root, struct context* c
         struct node* right;
         CHECK(parse_and(parser, &right, ctx), "failed to parse and");
 
-        struct node* bin_op = node_new(NODE_BINARY_OP, &operator_token, left, right);
+        struct node* bin_op = node_new(parser->arena, NODE_BINARY_OP, &operator_token, left, right);
         CHECK_NODE(bin_op);
 
         left = bin_op;
@@ -375,14 +408,14 @@ static int parse_expression_statement(struct parser* parser, struct node** root,
         struct node* assignment_value;
         CHECK(parse_expression(parser, &assignment_value, ctx), "failed to parse expression");
 
-        struct node* assignment_node = node_new(NODE_ASSIGN, NULL, expression, assignment_value);
+        struct node* assignment_node = node_new(parser->arena, NODE_ASSIGN, NULL, expression, assignment_value);
         CHECK_NODE(assignment_node);
 
         *root = assignment_node;
         return 0;
     }
 
-    struct node* expression_statement_node = node_new(NODE_EXP_STATEMENT, NULL, expression, NULL);
+    struct node* expression_statement_node = node_new(parser->arena, NODE_EXP_STATEMENT, NULL, expression, NULL);
     CHECK_NODE(expression_statement_node);
 
     *root = expression_statement_node;
@@ -411,10 +444,10 @@ static int parse_if(struct parser* parser, struct node** root, struct context* c
         CHECK(parse_block(parser, &false_side, ctx, true), "failed to parse block");
     }
 
-    struct node* decision = node_new(NODE_DECISION, NULL, true_side, false_side);
+    struct node* decision = node_new(parser->arena, NODE_DECISION, NULL, true_side, false_side);
     CHECK_NODE(decision);
 
-    struct node* if_node = node_new(NODE_IF, NULL, if_expression, decision);
+    struct node* if_node = node_new(parser->arena, NODE_IF, NULL, if_expression, decision);
     CHECK_NODE(if_node);
 
     *root = if_node;
@@ -433,10 +466,10 @@ static int parse_while(struct parser* parser, struct node** root, struct context
     struct node* true_side;
     CHECK(parse_block(parser, &true_side, ctx, true), "failed to parse block");
 
-    struct node* decision = node_new(NODE_DECISION, NULL, true_side, NULL);
+    struct node* decision = node_new(parser->arena, NODE_DECISION, NULL, true_side, NULL);
     CHECK_NODE(decision);
 
-    struct node* while_node = node_new(NODE_WHILE, NULL, while_expression, decision);
+    struct node* while_node = node_new(parser->arena, NODE_WHILE, NULL, while_expression, decision);
     CHECK_NODE(while_node);
 
     *root = while_node;
@@ -444,6 +477,33 @@ static int parse_while(struct parser* parser, struct node** root, struct context
     return 0;
 }
 
+static int parse_for(struct parser* parser, struct node** root, struct context* ctx) {
+    const struct token* current_token = get_current_token();
+
+    EXPECT_TOKEN(current_token->code, TOK_FOR);
+    advance();
+
+    const struct token variable_name = *get_current_token();
+    EXPECT_TOKEN(variable_name.code, TOK_IDN);
+    advance();
+
+    current_token = get_current_token();
+    EXPECT_TOKEN(current_token->code, TOK_IN);
+    advance();
+
+    struct node* iterable;
+    CHECK(parse_expression(parser, &iterable, ctx), "failed to parse expression");
+
+    struct node* body;
+    CHECK(parse_block(parser, &body, ctx, true), "failed to parse block");
+
+    struct node* for_node = node_new(parser->arena, NODE_FOR, &variable_name, iterable, body);
+    CHECK_NODE(for_node);
+
+    *root = for_node;
+
+    return 0;
+}
 
 static int parse_parameter_list(struct parser* parser, struct node** root, struct context* ctx) {
     (void) ctx;
@@ -468,7 +528,7 @@ static int parse_parameter_list(struct parser* parser, struct node** root, struc
             current_token = get_current_token();
         }
 
-        parameters = node_new(NODE_PARAMETER, &parameter_name, NULL, parameters);
+        parameters = node_new(parser->arena, NODE_PARAMETER, &parameter_name, NULL, parameters);
         CHECK_NODE(parameters);
     }
 
@@ -502,7 +562,7 @@ static int parse_export(struct parser* parser, struct node** root, struct contex
         return 1;
     }
 
-    struct node* export = node_new(NODE_EXPORT, NULL, export_value, NULL);
+    struct node* export = node_new(parser->arena, NODE_EXPORT, NULL, export_value, NULL);
     CHECK_NODE(export);
 
     *root = export;
@@ -525,13 +585,28 @@ static int parse_function(struct parser* parser, struct node** root, struct cont
     struct node* body;
     CHECK(parse_block(parser, &body, ctx, true), "failed to parse block");
 
-    struct node* function = node_new(NODE_FUNCTION, &function_name, arguments, body);
+    struct node* function = node_new(parser->arena, NODE_FUNCTION, &function_name, arguments, body);
     CHECK_NODE(function);
 
     *root = function;
     return 0;
 }
 
+static int parse_memo(struct parser* parser, struct node** root, struct context* ctx) {
+    const struct token* current_token = get_current_token();
+
+    EXPECT_TOKEN(current_token->code, TOK_MEM);
+    advance();
+
+    struct node* function;
+    CHECK(parse_function(parser, &function, ctx), "failed to parse function");
+
+    function->flags |= MEMO;
+
+    *root = function;
+    return 0;
+}
+
 static int parse_return(struct parser* parser, struct node** root, struct context* ctx) {
     const struct token* current_token = get_current_token();
 
@@ -544,7 +619,7 @@ static int parse_return(struct parser* parser, struct node** root, struct contex
         CHECK(parse_expression(parser, &expression, ctx), "failed to parse expression");
     }
 
-    struct node* return_node = node_new(NODE_RETURN, NULL, expression, NULL);
+    struct node* return_node = node_new(parser->arena, NODE_RETURN, NULL, expression, NULL);
     CHECK_NODE(return_node);
 
     *root = return_node;
@@ -560,9 +635,8 @@ static int parse_declaration(struct parser* parser, struct node** root, struct c
 
     current_token = get_current_token();
     EXPECT_TOKEN(current_token->code, TOK_IDN);
-    advance();
-
     const struct token identifier = *current_token;
+    advance();
 
     current_token = get_current_token();
     struct node* init_value = NULL;
@@ -571,7 +645,7 @@ static int parse_declaration(struct parser* parser, struct node** root, struct c
         CHECK(parse_expression(parser, &init_value, ctx), "failed to parse expression");
     }
 
-    struct node* declaration = node_new(NODE_DECLARATION, &identifier, init_value, NULL);
+    struct node* declaration = node_new(parser->arena, NODE_DECLARATION, &identifier, init_value, NULL);
     CHECK_NODE(declaration);
 
     *root = declaration;
@@ -603,7 +677,7 @@ static int parse_class(struct parser* parser, struct node** root, struct context
         current_token = get_current_token();
         EXPECT_TOKEN(current_token->code, TOK_IDN);
 
-        members = node_new(NODE_MEMBER, current_token, NULL, members);
+        members = node_new(parser->arena, NODE_MEMBER, current_token, NULL, members);
         CHECK_NODE(members);
 
         advance();
@@ -616,7 +690,7 @@ static int parse_class(struct parser* parser, struct node** root, struct context
         CHECK(parse_function(parser, &method, ctx), "failed to parse method");
         method->type = NODE_METHOD;
 
-        methods = node_new(NODE_METHODS, NULL, method, methods);
+        methods = node_new(parser->arena, NODE_METHODS, NULL, method, methods);
         CHECK_NODE(methods);
 
         current_token = get_current_token();
@@ -625,7 +699,7 @@ static int parse_class(struct parser* parser, struct node** root, struct context
     EXPECT_TOKEN(current_token->code, TOK_RBR);
     advance();
 
-    struct node* class_node = node_new(NODE_CLASS, &class_name, members, methods);
+    struct node* class_node = node_new(parser->arena, NODE_CLASS, &class_name, members, methods);
     CHECK_NODE(class_node);
 
     *root = class_node;
@@ -640,9 +714,8 @@ static int parse_constant(struct parser* parser, struct node** root, struct cont
 
     current_token = get_current_token();
     EXPECT_TOKEN(current_token->code, TOK_IDN);
-    advance();
-
     const struct token identifier = *current_token;
+    advance();
 
     current_token = get_current_token();
     struct node* const_value = NULL;
@@ -651,7 +724,7 @@ static int parse_constant(struct parser* parser, struct node** root, struct cont
         CHECK(parse_literal(parser, &const_value, ctx), "failed to parse literal");
     }
 
-    struct node* declaration = node_new(NODE_CONSTANT, &identifier, const_value, NULL);
+    struct node* declaration = node_new(parser->arena, NODE_CONSTANT, &identifier, const_value, NULL);
     CHECK_NODE(declaration);
 
     *root = declaration;
@@ -674,7 +747,7 @@ static int parse_import(struct parser* parser, struct node** root, struct contex
     struct node* block = NULL;
     CHECK(parse(parser, &block), "failed to parse module");
 
-    struct node* import_node = node_new(NODE_IMPORT, NULL, block, NULL);
+    struct node* import_node = node_new(parser->arena, NODE_IMPORT, NULL, block, NULL);
     CHECK_NODE(import_node);
 
     *root = import_node;
@@ -694,11 +767,21 @@ static int parse_statement(struct parser* parser, struct node** root, struct con
         return 0;
     }
 
+    if (current_token_code == TOK_FOR) {
+        CHECK(parse_for(parser, root, ctx), "failed to parse for statement");
+        return 0;
+    }
+
     if (current_token_code == TOK_FUN) {
         CHECK(parse_function(parser, root, ctx), "failed to parse function");
         return 0;
     }
 
+    if (current_token_code == TOK_MEM) {
+        CHECK(parse_memo(parser, root, ctx), "failed to parse memo function");
+        return 0;
+    }
+
     if (current_token_code == TOK_VAR) {
         CHECK(parse_declaration(parser, root, ctx), "failed to parse declaration");
         return 0;
@@ -746,7 +829,7 @@ static int parse_block(struct parser* parser, struct node** root, struct context
         struct node* statement;
         CHECK(parse_statement(parser, &statement, ctx), "failed to parse statement");
 
-        statements = node_new(NODE_STATEMENT, NULL, statement, statements);
+        statements = node_new(parser->arena, NODE_STATEMENT, NULL, statement, statements);
         CHECK_NODE(statements);
 
         current_token = get_current_token();
@@ -759,7 +842,7 @@ static int parse_block(struct parser* parser, struct node** root, struct context
         EXPECT_TOKEN(current_token->code, TOK_EOF);
     }
 
-    struct node* block = node_new(NODE_BLOCK, NULL, statements, NULL);
+    struct node* block = node_new(parser->arena, NODE_BLOCK, NULL, statements, NULL);
     CHECK_NODE(block);
 
     *root = block;
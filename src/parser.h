@@ -34,18 +34,28 @@ enum node_type {
     NODE_METHOD        = 24,
     NODE_CONSTANT      = 25,
     NODE_EXPORT        = 26,
-    NODE_IMPORT        = 27
+    NODE_IMPORT        = 27,
+    NODE_FOR           = 28
 };
 
 enum NODE_FLAGS {
     LVALUE   = (0x1 << 0),
     CALLABLE = (0x1 << 1),
-    LEFT     = (0x1 << 2)
+    LEFT     = (0x1 << 2),
+    MEMO     = (0x1 << 3)
 };
 
+struct intern_table;
+
 struct parser {
     struct token current_token;
     struct lexer* l;
+
+    // the identifiers and strings the parser keeps are interned when set, otherwise they are copied in the arena
+    struct intern_table* strings;
+
+    // owns the nodes of the tree
+    struct ast_arena* arena;
 };
 
 int parse(struct parser* parser, struct node** root );
@@ -0,0 +1,210 @@
+#include "slab.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils.h"
+
+// the first block is placed after the page header
+#define FIRST_BLOCK ((sizeof(struct slab_page) + 15) & ~(size_t)15)
+
+static const uint32_t class_sizes[SLAB_N_CLASSES] = {
+    16, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024, 1536, 2048, 3072, 4096, 6144, 8192
+};
+
+static uint32_t size_class(size_t size) {
+    if (size <= 64)
+        return size ? (size - 1) / 16 : 0;
+
+    uint32_t i = 4;
+    while (class_sizes[i] < size) {
+        ++i;
+    }
+
+    return i;
+}
+
+static struct slab_page* page_of(void* mem) {
+    return (struct slab_page*)((uintptr_t)mem & ~(uintptr_t)(SLAB_PAGE_SIZE - 1));
+}
+
+static void push_partial(struct slab_class* cls, struct slab_page* page) {
+    page->prev = NULL;
+    page->next = cls->partial;
+
+    if (cls->partial)
+        cls->partial->prev = page;
+
+    cls->partial = page;
+}
+
+static void remove_partial(struct slab_class* cls, struct slab_page* page) {
+    if (page->prev) {
+        page->prev->next = page->next;
+    } else {
+        cls->partial = page->next;
+    }
+
+    if (page->next)
+        page->next->prev = page->prev;
+
+    page->prev = NULL;
+    page->next = NULL;
+}
+
+static struct slab_page* new_page(struct slab_allocator* slab, uint32_t index) {
+    struct slab_page* page = aligned_alloc(SLAB_PAGE_SIZE, SLAB_PAGE_SIZE);
+    if (!page)
+        return NULL;
+
+    *page = (struct slab_page) {
+        .next_page = slab->pages,
+        .top = FIRST_BLOCK,
+        .size_class = index
+    };
+
+    if (slab->pages)
+        slab->pages->prev_page = page;
+
+    slab->pages = page;
+
+    struct slab_class* cls = &slab->classes[index];
+    push_partial(cls, page);
+    ++cls->n_pages;
+
+    return page;
+}
+
+static void release_page(struct slab_allocator* slab, struct slab_page* page) {
+    struct slab_class* cls = &slab->classes[page->size_class];
+    remove_partial(cls, page);
+    --cls->n_pages;
+
+    if (page->prev_page) {
+        page->prev_page->next_page = page->next_page;
+    } else {
+        slab->pages = page->next_page;
+    }
+
+    if (page->next_page)
+        page->next_page->prev_page = page->prev_page;
+
+    free(page);
+}
+
+int slab_init(struct slab_allocator* slab) {
+    *slab = (struct slab_allocator){};
+
+    if (pthread_mutex_init(&slab->lock, NULL) != 0) {
+        ERROR("failed to initialize the allocator lock");
+        return 1;
+    }
+
+    return 0;
+}
+
+void* slab_alloc(struct slab_allocator* slab, size_t size) {
+    if (size > SLAB_MAX_SIZE)
+        return malloc(size);
+
+    uint32_t index = size_class(size);
+    uint32_t block_size = class_sizes[index];
+
+    pthread_mutex_lock(&slab->lock);
+
+    struct slab_class* cls = &slab->classes[index];
+
+    struct slab_page* page = cls->partial;
+    if (!page) {
+        page = new_page(slab, index);
+        if (!page) {
+            pthread_mutex_unlock(&slab->lock);
+            return NULL;
+        }
+    }
+
+    void* block;
+    if (page->free) {
+        block = page->free;
+        page->free = *(void**)block;
+    } else {
+        // blocks that were never used are carved from the end of the page
+        block = (uint8_t*)page + page->top;
+        page->top += block_size;
+    }
+
+    ++page->n_used;
+
+    // a full page leaves the partial list until one of its blocks is released
+    if (!page->free && page->top + block_size > SLAB_PAGE_SIZE)
+        remove_partial(cls, page);
+
+    pthread_mutex_unlock(&slab->lock);
+    return block;
+}
+
+void* slab_realloc(struct slab_allocator* slab, void* mem, size_t old_size, size_t new_size) {
+    if (!mem)
+        return slab_alloc(slab, new_size);
+
+    if (old_size > SLAB_MAX_SIZE && new_size > SLAB_MAX_SIZE)
+        return realloc(mem, new_size);
+
+    // the block already fits the new size
+    if (old_size <= SLAB_MAX_SIZE && new_size <= SLAB_MAX_SIZE && size_class(old_size) == size_class(new_size))
+        return mem;
+
+    void* new_mem = slab_alloc(slab, new_size);
+    if (!new_mem)
+        return NULL;
+
+    memcpy(new_mem, mem, old_size < new_size ? old_size : new_size);
+    slab_dealloc(slab, mem, old_size);
+
+    return new_mem;
+}
+
+void slab_dealloc(struct slab_allocator* slab, void* mem, size_t size) {
+    if (!mem)
+        return;
+
+    if (size > SLAB_MAX_SIZE) {
+        free(mem);
+        return;
+    }
+
+    struct slab_page* page = page_of(mem);
+
+    pthread_mutex_lock(&slab->lock);
+
+    struct slab_class* cls = &slab->classes[page->size_class];
+
+    bool was_full = !page->free && page->top + class_sizes[page->size_class] > SLAB_PAGE_SIZE;
+
+    *(void**)mem = page->free;
+    page->free = mem;
+    --page->n_used;
+
+    if (was_full)
+        push_partial(cls, page);
+
+    // one empty page is kept for every class so a class doesn't allocate and release a page in a loop
+    if (page->n_used == 0 && cls->n_pages > 1)
+        release_page(slab, page);
+
+    pthread_mutex_unlock(&slab->lock);
+}
+
+void slab_free(struct slab_allocator* slab) {
+    struct slab_page* page = slab->pages;
+    while (page) {
+        struct slab_page* next = page->next_page;
+        free(page);
+        page = next;
+    }
+
+    pthread_mutex_destroy(&slab->lock);
+
+    *slab = (struct slab_allocator){};
+}
@@ -0,0 +1,114 @@
+#ifndef SLAB_H_
+#define SLAB_H_
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// every slab is a page aligned to its size, so a block finds its page by masking its address
+#define SLAB_PAGE_SIZE (1 << 16)
+
+// bigger blocks are allocated with malloc
+#define SLAB_MAX_SIZE 8192
+
+#define SLAB_N_CLASSES 18
+
+/**
+ * page split in blocks of the same size class
+ *
+ * @field prev previous page of the class with free blocks
+ * @field next next page of the class with free blocks
+ * @field prev_page previous page of the allocator
+ * @field next_page next page of the allocator
+ * @field free released blocks of the page, linked through their first bytes
+ * @field top offset of the first block that was never allocated
+ * @field n_used allocated blocks count
+ * @field size_class index of the size class
+ */
+struct slab_page {
+    struct slab_page* prev;
+    struct slab_page* next;
+
+    struct slab_page* prev_page;
+    struct slab_page* next_page;
+
+    void* free;
+    uint32_t top;
+
+    uint32_t n_used;
+    uint32_t size_class;
+};
+
+/**
+ * pages of a size class
+ *
+ * @field partial pages with at least a free block
+ * @field n_pages pages count of the class
+ */
+struct slab_class {
+    struct slab_page* partial;
+    size_t n_pages;
+};
+
+/**
+ * size class allocator of the virtual machine, the blocks can be released from any
+ * thread so the gc sweeper can free the dead objects while the interpreter allocates
+ *
+ * @field classes size classes, the blocks are 16 bytes aligned
+ * @field pages all of the pages
+ * @field lock protects the pages
+ */
+struct slab_allocator {
+    struct slab_class classes[SLAB_N_CLASSES];
+    struct slab_page* pages;
+    pthread_mutex_t lock;
+};
+
+/**
+ * initialize an allocator
+ *
+ * @param slab allocator
+ *
+ * @return success code
+ */
+int slab_init(struct slab_allocator* slab);
+
+/**
+ * allocate a block, the size must be passed again when the block is released
+ *
+ * @param slab allocator
+ * @param size block size
+ *
+ * @return block memory or NULL on failure
+ */
+void* slab_alloc(struct slab_allocator* slab, size_t size);
+
+/**
+ * change the size of a block, the content is kept up to the smaller size
+ *
+ * @param slab allocator
+ * @param mem block memory or NULL to allocate a new block
+ * @param old_size size the block was allocated with
+ * @param new_size new block size
+ *
+ * @return new block memory or NULL on failure, the old block is still valid on failure
+ */
+void* slab_realloc(struct slab_allocator* slab, void* mem, size_t old_size, size_t new_size);
+
+/**
+ * release a block, empty pages are given back to the system
+ *
+ * @param slab allocator
+ * @param mem block memory or NULL
+ * @param size size the block was allocated with
+ */
+void slab_dealloc(struct slab_allocator* slab, void* mem, size_t size);
+
+/**
+ * release all of the pages, the blocks that were not released become invalid
+ *
+ * @param slab allocator
+ */
+void slab_free(struct slab_allocator* slab);
+
+#endif
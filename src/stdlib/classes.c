@@ -1,96 +1,149 @@
+#include <inttypes.h>
 #include <stdint.h>
 #include <stdlib.h>
 
 #include "classes.h"
+#include "../utils.h"
 #include "../vm.h"
 
-struct list_context {
-    struct sylk_object* container;
-    uint32_t n_elements;
-    uint32_t allocated;
-};
-
 #define INIT_SIZE 1
 
 static void list_free(void* mem) {
     struct list_context* ctx = mem;
 
-    free(ctx->container);
-    free(ctx);
+    slab_dealloc(ctx->slab, ctx->container, ctx->allocated * sizeof(*ctx->container));
+    slab_dealloc(ctx->slab, ctx, sizeof(*ctx));
 }
 
 static struct sylk_object list_constructor(struct sylk_object* self, struct sylk_vm* vm, void* ctx) {
-    (void)vm;
     (void)ctx;
 
-    struct sylk_object* container = malloc(INIT_SIZE * sizeof(*container));
-    struct list_context* context = malloc(sizeof(*context));
+    sylk_value* container = slab_alloc(&vm->slab, INIT_SIZE * sizeof(*container));
+    if (!container) {
+        MEMORY_ERROR();
+        vm->builtin_failed = true;
+        return (struct sylk_object){};
+    }
+
+    struct list_context* context = slab_alloc(&vm->slab, sizeof(*context));
+    if (!context) {
+        slab_dealloc(&vm->slab, container, INIT_SIZE * sizeof(*container));
+
+        MEMORY_ERROR();
+        vm->builtin_failed = true;
+        return (struct sylk_object){};
+    }
+
     *context = (struct list_context) {
         .container = container,
-        .allocated = INIT_SIZE
+        .allocated = INIT_SIZE,
+        .slab = &vm->slab
     };
 
-    struct sylk_object_user* user = gc_alloc(vm, SYLK_OBJ_NUMBER, sizeof(*user));
+    struct sylk_object_user* user = gc_alloc(vm, SYLK_OBJ_USER, sizeof(*user));
+    if (!user) {
+        list_free(context);
+
+        MEMORY_ERROR();
+        vm->builtin_failed = true;
+        return (struct sylk_object){};
+    }
+
     *user = (struct sylk_object_user) {
         .mem = context,
         .free_fun = list_free
     };
 
     struct sylk_object_instance* instance = self->obj_value;
-    instance->members[0] = (struct sylk_object) {
-        .type = SYLK_OBJ_NUMBER,
+    instance->members[0] = value_box_object((struct sylk_object) {
+        .type = SYLK_OBJ_USER,
         .obj_value = user
-    };
+    });
 
     return (struct sylk_object){};
 }
 
+// a list whose constructor failed has no user object
+static struct list_context* list_of(const struct sylk_object_instance* instance) {
+    struct sylk_object user = value_unbox(instance->members[0]);
+    if (user.type != SYLK_OBJ_USER || !user.obj_value)
+        return NULL;
+
+    return ((struct sylk_object_user*)user.obj_value)->mem;
+}
+
+static struct list_context* method_list(struct sylk_object* self, struct sylk_vm* vm) {
+    struct list_context* context = list_of(self->obj_value);
+    if (!context) {
+        ERROR("list was not constructed");
+        vm->builtin_failed = true;
+    }
+
+    return context;
+}
+
 static struct sylk_object list_add(struct sylk_object* self, struct sylk_vm* vm, void* ctx) {
     (void)ctx;
 
     struct sylk_object_instance* instance = self->obj_value;
-    struct sylk_object_user* user = instance->members[0].obj_value;
-    struct list_context* context = user->mem;
+    struct list_context* context = method_list(self, vm);
+    if (!context)
+        return (struct sylk_object){};
 
     if (context->n_elements >= context->allocated) {
         uint32_t new_alloc_size = context->allocated * 2;
 
-        struct sylk_object* new_mem = realloc(context->container, new_alloc_size * sizeof(*context->container));
+        // the old container is still valid when the realloc fails
+        sylk_value* new_mem = slab_realloc(context->slab, context->container, context->allocated * sizeof(*context->container), new_alloc_size * sizeof(*context->container));
+        if (!new_mem) {
+            MEMORY_ERROR();
+            vm->builtin_failed = true;
+            return (struct sylk_object){};
+        }
+
         context->container = new_mem;
         context->allocated = new_alloc_size;
     }
 
-    context->container[context->n_elements++] = pop();
+    context->container[context->n_elements] = pop_value();
+    gc_write_barrier_value(vm, instance, context->container[context->n_elements]);
+
+    ++context->n_elements;
     return (struct sylk_object){};
 }
 
 static struct sylk_object list_pop(struct sylk_object* self, struct sylk_vm* vm, void* ctx) {
-    (void)vm;
     (void)ctx;
 
-    struct sylk_object_instance* instance = self->obj_value;
-    struct sylk_object_user* user = instance->members[0].obj_value;
-    struct list_context* context = user->mem;
+    struct list_context* context = method_list(self, vm);
+    if (!context)
+        return (struct sylk_object){};
 
-    return context->container[--context->n_elements];
+    if (context->n_elements == 0) {
+        ERROR("pop from an empty list");
+        vm->builtin_failed = true;
+        return (struct sylk_object){};
+    }
+
+    return value_unbox(context->container[--context->n_elements]);
 }
 
 static void iterate_objects(struct sylk_object_instance* self, sylk_object_callback cb, void* ctx) {
-    struct sylk_object_user* user = self->members[0].obj_value;
-    struct list_context* context = user->mem;
+    struct list_context* context = list_of(self);
+    if (!context)
+        return;
 
     for (uint32_t i = 0; i < context->n_elements; ++i) {
-        cb(&context->container[i], ctx);
+        value_visit(&context->container[i], cb, ctx);
     }
 }
 
 static struct sylk_object list_length(struct sylk_object* self, struct sylk_vm* vm, void* ctx) {
-    (void)vm;
     (void)ctx;
 
-    struct sylk_object_instance* instance = self->obj_value;
-    struct sylk_object_user* user = instance->members[0].obj_value;
-    struct list_context* context = user->mem;
+    struct list_context* context = method_list(self, vm);
+    if (!context)
+        return (struct sylk_object){};
 
     return (struct sylk_object) {.type = SYLK_OBJ_NUMBER, .num_value = context->n_elements};
 }
@@ -99,11 +152,19 @@ static struct sylk_object list_set(struct sylk_object* self, struct sylk_vm* vm,
     (void)ctx;
 
     struct sylk_object_instance* instance = self->obj_value;
-    struct sylk_object_user* user = instance->members[0].obj_value;
-    struct list_context* context = user->mem;
+    struct list_context* context = method_list(self, vm);
+    if (!context)
+        return (struct sylk_object){};
 
     uint32_t index = pop().num_value;
-    context->container[index] = pop();
+    if (index >= context->n_elements) {
+        ERROR("index %" PRIu32 " out of range", index);
+        vm->builtin_failed = true;
+        return (struct sylk_object){};
+    }
+
+    context->container[index] = pop_value();
+    gc_write_barrier_value(vm, instance, context->container[index]);
 
     return (struct sylk_object){};
 }
@@ -111,12 +172,29 @@ static struct sylk_object list_set(struct sylk_object* self, struct sylk_vm* vm,
 static struct sylk_object list_get(struct sylk_object* self, struct sylk_vm* vm, void* ctx) {
     (void)ctx;
 
-    struct sylk_object_instance* instance = self->obj_value;
-    struct sylk_object_user* user = instance->members[0].obj_value;
-    struct list_context* context = user->mem;
+    struct list_context* context = method_list(self, vm);
+    if (!context)
+        return (struct sylk_object){};
 
     uint32_t index = pop().num_value;
-    return context->container[index];
+    if (index >= context->n_elements) {
+        ERROR("index %" PRIu32 " out of range", index);
+        vm->builtin_failed = true;
+        return (struct sylk_object){};
+    }
+
+    return value_unbox(context->container[index]);
+}
+
+struct list_context* get_list(const struct sylk_object* o) {
+    if (o->type != SYLK_OBJ_INSTANCE)
+        return NULL;
+
+    struct sylk_object_instance* instance = o->obj_value;
+    if (instance->cls->iterate_fun != iterate_objects)
+        return NULL;
+
+    return list_of(instance);
 }
 
 int add_builtin_classes(struct sylk_named_class* classes, size_t* n_classes){
@@ -2,8 +2,34 @@
 #define CLASSES_H_
 
 #include "../compiler.h"
+#include "../slab.h"
+
+/**
+ * internal state of the builtin "list" class
+ *
+ * @field container list elements
+ * @field n_elements elements count
+ * @field allocated container capacity
+ * @field slab allocator of the container, the list is freed by the gc without the virtual machine
+ */
+struct list_context {
+    sylk_value* container;
+    uint32_t n_elements;
+    uint32_t allocated;
+
+    struct slab_allocator* slab;
+};
 
 struct sylk_named_class;
 int add_builtin_classes(struct sylk_named_class* classes, size_t* n_classes);
 
+/**
+ * get the internal state of a builtin list
+ *
+ * @param o object to inspect
+ *
+ * @return list state or NULL if the object is not a builtin list
+ */
+struct list_context* get_list(const struct sylk_object* o);
+
 #endif
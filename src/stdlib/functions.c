@@ -1,11 +1,26 @@
+#include <inttypes.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "functions.h"
 #include "../objects.h"
+#include "../sylk_string.h"
 
 #include "../vm.h"
 
+// shortest text that reads back as the same double, with a '.' so it doesn't look like an integer
+static int format_float(double number, char* buffer, size_t size) {
+    int length = snprintf(buffer, size, "%.15g", number);
+    if (strtod(buffer, NULL) != number)
+        length = snprintf(buffer, size, "%.17g", number);
+
+    if (strspn(buffer, "-0123456789") == (size_t)length)
+        length += snprintf(buffer + length, size - length, ".0");
+
+    return length;
+}
+
 static struct sylk_object print_object(struct sylk_object* self, struct sylk_vm* vm, void* ctx) {
     (void)self;
     (void)ctx;
@@ -13,9 +28,18 @@ static struct sylk_object print_object(struct sylk_object* self, struct sylk_vm*
     struct sylk_object o = pop();
 
     if (o.type == SYLK_OBJ_NUMBER) {
-        printf("%d\n", o.num_value);
+        printf("%" PRId64 "\n", o.num_value);
+    } else if (o.type == SYLK_OBJ_FLOAT) {
+        char buffer[32];
+        format_float(o.float_value, buffer, sizeof(buffer));
+
+        puts(buffer);
     } else if (o.type == SYLK_OBJ_STRING) {
-        printf("%s\n", o.str_value);
+        const char* chars = string_chars(vm, &o);
+        if (chars)
+            fwrite(chars, 1, string_length(&o), stdout);
+
+        putchar('\n');
     } else if (o.type == SYLK_OBJ_BOOL) {
         printf("%s\n", o.bool_value ? "true" : "false");
     } else if (o.type == SYLK_OBJ_CLASS) {
@@ -37,11 +61,12 @@ static struct sylk_object input_number(struct sylk_object* self, struct sylk_vm*
 
     struct sylk_object o = pop();
 
-    const char* input_text = o.str_value;
-    printf("%s", input_text);
+    const char* prompt = string_chars(vm, &o);
+    if (prompt)
+        fwrite(prompt, 1, string_length(&o), stdout);
 
-    int32_t number;
-    scanf("%d", &number);
+    int64_t number = 0;
+    scanf("%" SCNd64, &number);
 
     puts("");
 
@@ -52,12 +77,21 @@ static struct sylk_object to_string(struct sylk_object* self, struct sylk_vm* vm
     (void)self;
     (void)ctx;
 
-    char* str = gc_alloc(vm, SYLK_OBJ_STRING, 200);
-
     struct sylk_object num = pop();
 
-    sprintf(str, "%d", num.num_value);
-    return (struct sylk_object){.type = SYLK_OBJ_STRING, .str_value = str};
+    char buffer[32];
+    int length;
+
+    if (num.type == SYLK_OBJ_FLOAT) {
+        length = format_float(num.float_value, buffer, sizeof(buffer));
+    } else {
+        length = snprintf(buffer, sizeof(buffer), "%" PRId64, num.num_value);
+    }
+
+    struct sylk_object str = {};
+    string_object(vm, buffer, length, &str);
+
+    return str;
 }
 
 static struct sylk_object to_int(struct sylk_object* self, struct sylk_vm* vm, void* ctx) {
@@ -66,26 +100,80 @@ static struct sylk_object to_int(struct sylk_object* self, struct sylk_vm* vm, v
 
     struct sylk_object str = pop();
 
+    // doubles are truncated
+    if (str.type == SYLK_OBJ_FLOAT)
+        return (struct sylk_object){.type = SYLK_OBJ_NUMBER, .num_value = (int64_t)str.float_value};
+
+    if (str.type == SYLK_OBJ_NUMBER)
+        return str;
+
+    const char* chars = string_chars(vm, &str);
+    if (!chars)
+        return (struct sylk_object){};
+
     char* end = NULL;
-    int32_t num = strtol(str.str_value, &end, 10);
+    int64_t num = strtoll(chars, &end, 10);
 
     return (struct sylk_object){.type = SYLK_OBJ_NUMBER, .num_value = num};
 }
 
+static struct sylk_object to_float(struct sylk_object* self, struct sylk_vm* vm, void* ctx) {
+    (void)self;
+    (void)ctx;
+
+    struct sylk_object o = pop();
+
+    if (o.type == SYLK_OBJ_NUMBER || o.type == SYLK_OBJ_FLOAT)
+        return (struct sylk_object){.type = SYLK_OBJ_FLOAT, .float_value = o.type == SYLK_OBJ_FLOAT ? o.float_value : (double)o.num_value};
+
+    const char* chars = string_chars(vm, &o);
+    if (!chars)
+        return (struct sylk_object){};
+
+    return (struct sylk_object){.type = SYLK_OBJ_FLOAT, .float_value = strtod(chars, NULL)};
+}
+
 static struct sylk_object input_string(struct sylk_object* self, struct sylk_vm* vm, void* ctx) {
     (void)self;
     (void)ctx;
 
     struct sylk_object o = pop();
 
-    const char* input_text = o.str_value;
-    printf("%s", input_text);
+    const char* prompt = string_chars(vm, &o);
+    if (prompt)
+        fwrite(prompt, 1, string_length(&o), stdout);
 
-    char* string = gc_alloc(vm, SYLK_OBJ_STRING, 200);
-    scanf("%s", string);
+    char buffer[200];
+    int res = scanf("%199s", buffer);
+    if (res != 1)
+        buffer[0] = '\0';
+
+    struct sylk_object string = {};
+    string_object(vm, buffer, strlen(buffer), &string);
 
     puts("");
 
+    return string;
+}
+
+static struct sylk_object intern_string(struct sylk_object* self, struct sylk_vm* vm, void* ctx) {
+    (void)self;
+    (void)ctx;
+
+    struct sylk_object o = pop();
+    // small strings are always compared by their characters
+    if (o.type != SYLK_OBJ_STRING || o.small || o.str_value->interned)
+        return o;
+
+    struct sylk_string* flat = string_flatten(vm, o.str_value);
+    if (!flat)
+        return o;
+
+    // equal interned strings are compared by their address
+    struct sylk_string* string = intern(vm->strings, flat->data, flat->length);
+    if (!string)
+        return o;
+
     return (struct sylk_object){.type = SYLK_OBJ_STRING, .str_value = string};
 }
 
@@ -95,6 +183,8 @@ int add_builtin_functions(struct sylk_named_function* functions, size_t* n_funct
     functions[(*n_functions)++] = (struct sylk_named_function){.name = "input_string", (struct sylk_object_function){.type = SYLK_BUILT_IN, .n_parameters = 1, .function = input_string}};
     functions[(*n_functions)++] = (struct sylk_named_function){.name = "str", (struct sylk_object_function){.type = SYLK_BUILT_IN, .n_parameters = 1, .function = to_string}};
     functions[(*n_functions)++] = (struct sylk_named_function){.name = "int", (struct sylk_object_function){.type = SYLK_BUILT_IN, .n_parameters = 1, .function = to_int}};
+    functions[(*n_functions)++] = (struct sylk_named_function){.name = "float", (struct sylk_object_function){.type = SYLK_BUILT_IN, .n_parameters = 1, .function = to_float}};
+    functions[(*n_functions)++] = (struct sylk_named_function){.name = "intern", (struct sylk_object_function){.type = SYLK_BUILT_IN, .n_parameters = 1, .function = intern_string}};
 
     return 0;
 };
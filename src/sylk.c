@@ -1,5 +1,7 @@
 #include "sylk.h"
 
+#include <inttypes.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include "lexer.h"
@@ -24,6 +26,11 @@ struct sylk* sylk_new(const struct sylk_config* config, void* ctx) {
         .ctx = ctx
     };
 
+    if (intern_init(&s->strings) != 0) {
+        free(s);
+        return NULL;
+    }
+
     if (config == NULL) {
         s->config = &default_config;
     }
@@ -32,9 +39,21 @@ struct sylk* sylk_new(const struct sylk_config* config, void* ctx) {
 }
 
 void sylk_free(struct sylk* s) {
+    intern_free(&s->strings);
     free(s);
 }
 
+static void print_gc_stats(const struct sylk_gc_stats* stats) {
+    printf("gc collections: %" PRIu64 " minor, %" PRIu64 " major, %" PRIu64 " slices\n", stats->n_minor, stats->n_major, stats->n_slices);
+    printf("gc allocated: %" PRIu64 " objects, %" PRIu64 " bytes\n", stats->allocated_objects, stats->allocated_bytes);
+    printf("gc freed: %" PRIu64 " objects, %" PRIu64 " bytes\n", stats->freed_objects, stats->freed_bytes);
+    printf("gc live: %" PRIu64 " objects, %" PRIu64 " bytes\n", stats->live_objects, stats->live_bytes);
+    printf("gc promoted: %" PRIu64 " objects, %" PRIu64 " bytes\n", stats->promoted_objects, stats->promoted_bytes);
+    printf("gc heap high water: %" PRIu64 " bytes\n", stats->heap_high_water);
+    printf("gc pauses: %" PRIu64 " ns minor, %" PRIu64 " ns mark, %" PRIu64 " ns finish, %" PRIu64 " ns max\n", stats->minor_pause_ns, stats->mark_pause_ns, stats->finish_pause_ns, stats->max_pause_ns);
+    printf("gc sweep: %" PRIu64 " ns\n", stats->sweep_ns);
+}
+
 int sylk_run_string(struct sylk* s, const char* program, size_t program_size) {
     struct lexer l = {
         .text = program,
@@ -42,8 +61,13 @@ int sylk_run_string(struct sylk* s, const char* program, size_t program_size) {
         .line = 1
     };
 
+    // the tree is released after the compilation, or at the end of the program when the functions are compiled lazily
+    struct ast_arena arena = {};
+
     struct parser parser = {
-        .l = &l
+        .l = &l,
+        .strings = &s->strings,
+        .arena = &arena
     };
 
     struct node* ast = NULL;
@@ -56,6 +80,7 @@ int sylk_run_string(struct sylk* s, const char* program, size_t program_size) {
         ERROR("at line %d", token->line);
         print_program_error(program, token->index);
 
+        ast_arena_free(&arena);
         return 1;
     }
 
@@ -64,11 +89,37 @@ int sylk_run_string(struct sylk* s, const char* program, size_t program_size) {
         puts("");
     }
 
-    uint8_t bytecode[4096];
-    size_t n_bytecodes = 0;
+    uint8_t* bytecode = malloc(BYTECODE_CAPACITY);
+    if (!bytecode) {
+        ast_arena_free(&arena);
+
+        MEMORY_ERROR();
+        return 1;
+    }
+
+    uint32_t n_bytecodes = 0;
     uint32_t start_address;
 
-    CHECK(compile_program(s, ast, bytecode, &n_bytecodes, &start_address), "failed to compile program");
+    struct lazy_table lazy;
+    if (lazy_table_init(&lazy, s) != 0) {
+        free(bytecode);
+        ast_arena_free(&arena);
+        return 1;
+    }
+
+    if (compile_program(s, ast, &lazy, bytecode, BYTECODE_CAPACITY, &n_bytecodes, &start_address) != 0) {
+        ERROR("failed to compile program");
+
+        lazy_table_free(&lazy);
+        free(bytecode);
+        ast_arena_free(&arena);
+        return 1;
+    }
+
+    // every function body is already compiled
+    if (!s->config->lazy_compile)
+        ast_arena_free(&arena);
+
     if (s->config->print_bytecode) {
         disassembly(bytecode, n_bytecodes, start_address);
         puts("");
@@ -78,17 +129,43 @@ int sylk_run_string(struct sylk* s, const char* program, size_t program_size) {
         struct sylk_vm vm = {
             .bytes = bytecode,
             .n_bytes = n_bytecodes,
-            .start_address = start_address
+            .capacity = BYTECODE_CAPACITY,
+            .start_address = start_address,
+            .lazy = &lazy,
+            .strings = &s->strings
         };
 
-        if (execute(s, &vm) != 0) {
+        if (slab_init(&vm.slab) != 0) {
+            lazy_table_free(&lazy);
+            free(bytecode);
+            ast_arena_free(&arena);
+            return 1;
+        }
+
+        s->vm = &vm;
+        res = execute(s, &vm);
+        memo_free(&vm.memos);
+        gc_free(&vm);
+        slab_free(&vm.slab);
+        s->vm = NULL;
+
+        s->gc_stats = vm.gc.stats;
+        if (s->config->gc_print_stats)
+            print_gc_stats(&s->gc_stats);
+
+        if (res != 0) {
             ERROR("failed to execute");
+
+            lazy_table_free(&lazy);
+            free(bytecode);
+            ast_arena_free(&arena);
             return 1;
         }
     }
 
-    if (ast)
-        node_free(ast);
+    lazy_table_free(&lazy);
+    free(bytecode);
+    ast_arena_free(&arena);
 
     return 0;
 }
@@ -100,11 +177,25 @@ int sylk_run_file(struct sylk* s, const char* file_name) {
         return 1;
     }
 
-    char text[2048];
-    size_t size = fread(text, sizeof(char), sizeof(text), f);
+    fseek(f, 0, SEEK_END);
+    long file_size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    char* text = malloc(file_size + 1);
+    if (!text) {
+        fclose(f);
+
+        MEMORY_ERROR();
+        return 1;
+    }
+
+    size_t size = fread(text, sizeof(char), file_size, f);
     fclose(f);
 
-    CHECK(sylk_run_string(s, text, size), "failed to run program");
+    int res = sylk_run_string(s, text, size);
+    free(text);
+
+    CHECK(res, "failed to run program");
     return 0;
 }
 
@@ -118,6 +209,28 @@ int sylk_load_functions(struct sylk* s, struct sylk_function* functions) {
     return 0;
 }
 
+// the fields are found by comparing their interned names with the names of the class
+static int intern_class_names(struct sylk* s, struct sylk_object_class* cls) {
+    for (uint32_t i = 0; i < cls->n_members; ++i) {
+        if (!cls->members[i])
+            continue;
+
+        struct sylk_string* name = intern(&s->strings, cls->members[i], strlen(cls->members[i]));
+        CHECK_MEM(name);
+
+        cls->members[i] = name->data;
+    }
+
+    for (uint32_t i = 0; i < cls->n_methods; ++i) {
+        struct sylk_string* name = intern(&s->strings, cls->methods[i].name, strlen(cls->methods[i].name));
+        CHECK_MEM(name);
+
+        cls->methods[i].name = name->data;
+    }
+
+    return 0;
+}
+
 int sylk_load_classes(struct sylk* s, struct sylk_class* classes) {
     size_t i = 0;
     while (classes[i].name && classes[i].members) {
@@ -133,7 +246,13 @@ int sylk_load_classes(struct sylk* s, struct sylk_class* classes) {
 
         size_t j = 0;
         while (classes[i].members[j]) {
+            if (j >= SYLK_MAX_MEMBERS) {
+                ERROR("class %s has more than %d members", classes[i].name, SYLK_MAX_MEMBERS);
+                return 1;
+            }
+
             obj_cls->members[obj_cls->n_members++] = classes[i].members[j];
+            ++j;
         }
 
         j = 0;
@@ -153,6 +272,8 @@ int sylk_load_classes(struct sylk* s, struct sylk_class* classes) {
             ++j;
         }
 
+        CHECK(intern_class_names(s, obj_cls), "failed to load class %s", cls.name);
+
         s->builtin_classes[s->n_builtin_classes++] = cls;
         ++i;
     }
@@ -160,6 +281,11 @@ int sylk_load_classes(struct sylk* s, struct sylk_class* classes) {
     return 0;
 }
 
+int sylk_gc_stats(struct sylk* s, struct sylk_gc_stats* out_stats) {
+    *out_stats = s->vm ? s->vm->gc.stats : s->gc_stats;
+    return 0;
+}
+
 int sylk_push(struct sylk_vm* vm, const struct sylk_object* o){ 
     push(*o);
     return 0;
@@ -177,8 +303,14 @@ int sylk_peek(struct sylk_vm* vm, size_t n, struct sylk_object* o){
 
 int sylk_load_prelude(struct sylk* s) {
     add_builtin_functions(s->builtin_functions, &s->n_builtin_functions);
+
+    size_t first_class = s->n_builtin_classes;
     add_builtin_classes(s->builtin_classes, &s->n_builtin_classes);
 
+    for (size_t i = first_class; i < s->n_builtin_classes; ++i) {
+        CHECK(intern_class_names(s, &s->builtin_classes[i].cls), "failed to load class %s", s->builtin_classes[i].name);
+    }
+
     return 0;
 }
 
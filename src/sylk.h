@@ -3,13 +3,111 @@
 
 #include <stddef.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include "objects.h"
 
 
+/**
+ * statistics of the garbage collector, the bytes include the object headers
+ *
+ * @field n_minor minor collections count
+ * @field n_major major collections count
+ * @field n_slices incremental marking slices count
+ * @field allocated_objects objects allocated since the start of the program
+ * @field allocated_bytes bytes allocated since the start of the program
+ * @field freed_objects objects freed by the collections
+ * @field freed_bytes bytes freed by the collections
+ * @field live_objects objects allocated and not freed yet
+ * @field live_bytes bytes allocated and not freed yet
+ * @field promoted_objects objects copied from the nursery to the old generation
+ * @field promoted_bytes bytes copied from the nursery to the old generation
+ * @field heap_high_water maximum live bytes
+ * @field minor_pause_ns time spent in the minor collections outside of a marking
+ * @field mark_pause_ns time spent starting the markings and in their slices
+ * @field finish_pause_ns time spent finishing the markings
+ * @field sweep_ns time spent by the sweeper, it runs next to the program
+ * @field max_pause_ns longest pause of the program
+ */
+struct sylk_gc_stats {
+    uint64_t n_minor;
+    uint64_t n_major;
+    uint64_t n_slices;
+
+    uint64_t allocated_objects;
+    uint64_t allocated_bytes;
+    uint64_t freed_objects;
+    uint64_t freed_bytes;
+    uint64_t live_objects;
+    uint64_t live_bytes;
+    uint64_t promoted_objects;
+    uint64_t promoted_bytes;
+    uint64_t heap_high_water;
+
+    uint64_t minor_pause_ns;
+    uint64_t mark_pause_ns;
+    uint64_t finish_pause_ns;
+    uint64_t sweep_ns;
+    uint64_t max_pause_ns;
+};
+
+
+enum sylk_gc_phase {
+    SYLK_GC_MINOR,
+    SYLK_GC_MARK_START,
+    SYLK_GC_MARK_SLICE,
+    SYLK_GC_MARK_FINISH,
+    SYLK_GC_SWEEP
+};
+
+
+/**
+ * @field phase finished phase
+ * @field duration_ns duration of the phase
+ * @field stats statistics after the phase
+ */
+struct sylk_gc_event {
+    enum sylk_gc_phase phase;
+    uint64_t duration_ns;
+    const struct sylk_gc_stats* stats;
+};
+
+
+/**
+ * function called by the gc after every phase of a collection, on the interpreter thread
+ *
+ * @param event finished phase
+ * @param ctx user provided context in "sylk_new"
+ */
+typedef void (*sylk_gc_callback)(const struct sylk_gc_event* event, void* ctx);
+
+
+/**
+ * @field print_ast dump the abstract syntax tree before compiling
+ * @field print_bytecode dump the bytecodes before executing
+ * @field halt_program only compile the program without executing it
+ * @field memo_size maximum cached results of every "memo" function (0 for the default), clamped to 2^24
+ * @field lazy_compile compile function bodies on their first call
+ * @field compile_threads threads compiling the function bodies (0 for one per core)
+ * @field gc_growth_factor collect when the bytes allocated since the last collection exceed
+ *                         this factor of the live heap (0 for the default)
+ * @field gc_mark_budget objects marked in every pause of an incremental collection
+ *                       (0 to collect in a single pause)
+ * @field gc_threads threads marking the heap (0 or 1 to mark on the interpreter thread)
+ * @field gc_print_stats print the gc statistics when the program ends
+ * @field gc_callback function called after every phase of a collection (NULL for none)
+ */
 struct sylk_config {
     bool print_ast;
     bool print_bytecode;
     bool halt_program;
+    uint32_t memo_size;
+    bool lazy_compile;
+    uint32_t compile_threads;
+    float gc_growth_factor;
+    uint32_t gc_mark_budget;
+    uint32_t gc_threads;
+    bool gc_print_stats;
+    sylk_gc_callback gc_callback;
 };
 
 
@@ -105,6 +203,17 @@ int sylk_run_string(struct sylk* s, const char* program, size_t program_size);
 int sylk_run_file(struct sylk* s, const char* file_name);
 
 
+/**
+ * get the gc statistics of the running program, or of the last one if none is running
+ *
+ * @param s interpreter instance
+ * @param out_stats where the statistics will be stored
+ *
+ * @return success code
+ */
+int sylk_gc_stats(struct sylk* s, struct sylk_gc_stats* out_stats);
+
+
 /**
  * virtual machine instance
  */
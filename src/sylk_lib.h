@@ -1,8 +1,10 @@
 #ifndef _SYLK_LIB_H
 #define _SYLK_LIB_H
 
+#include "intern.h"
 #include "objects.h"
 #include "stddef.h"
+#include "sylk.h"
 
 struct sylk {
     struct sylk_named_function builtin_functions[1024];
@@ -13,6 +15,11 @@ struct sylk {
 
     const struct sylk_config* config;
 
+    struct sylk_vm* vm;
+    struct sylk_gc_stats gc_stats;
+
+    struct intern_table strings;
+
     void* ctx;
 };
 
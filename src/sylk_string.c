@@ -0,0 +1,244 @@
+#include "sylk_string.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "gc.h"
+#include "utils.h"
+#include "vm.h"
+
+struct sylk_string* string_alloc(struct sylk_vm* vm, uint32_t length) {
+    struct sylk_string* string = gc_alloc(vm, SYLK_OBJ_STRING, sylk_string_size(length));
+    if (!string)
+        return NULL;
+
+    string->length = length;
+    string->hash = 0;
+    string->interned = false;
+    string->rope = false;
+    string->data[length] = '\0';
+
+    return string;
+}
+
+struct sylk_string* string_new(struct sylk_vm* vm, const char* chars, uint32_t length) {
+    struct sylk_string* string = string_alloc(vm, length);
+    if (!string)
+        return NULL;
+
+    memcpy(string->data, chars, length);
+    return string;
+}
+
+int string_object(struct sylk_vm* vm, const char* chars, uint32_t length, struct sylk_object* out) {
+    if (length <= SYLK_SMALL_STRING_MAX) {
+        *out = (struct sylk_object){.type = SYLK_OBJ_STRING, .small = true, .small_length = length};
+
+        memset(out->small_value, 0, sizeof(out->small_value));
+        memcpy(out->small_value, chars, length);
+
+        return 0;
+    }
+
+    struct sylk_string* string = string_new(vm, chars, length);
+    CHECK_MEM(string);
+
+    *out = (struct sylk_object){.type = SYLK_OBJ_STRING, .str_value = string};
+    return 0;
+}
+
+uint32_t string_length(const struct sylk_object* string) {
+    return string->small ? string->small_length : string->str_value->length;
+}
+
+const char* string_flat_chars(const struct sylk_object* string) {
+    return string->small ? string->small_value : string->str_value->data;
+}
+
+const char* string_chars(struct sylk_vm* vm, const struct sylk_object* string) {
+    if (string->small)
+        return string->small_value;
+
+    struct sylk_string* flat = string_flatten(vm, string->str_value);
+    if (!flat)
+        return NULL;
+
+    return flat->data;
+}
+
+int string_concat(struct sylk_vm* vm, const struct sylk_object* s1, const struct sylk_object* s2, struct sylk_object* out) {
+    uint32_t length1 = string_length(s1);
+    uint32_t length2 = string_length(s2);
+
+    if (length1 > UINT32_MAX - length2) {
+        ERROR("string is too long");
+        return 1;
+    }
+
+    uint32_t length = length1 + length2;
+
+    // ropes are never shorter than the minimum, so both strings are flat
+    if (length < ROPE_MIN_LENGTH) {
+        char* data;
+
+        if (length <= SYLK_SMALL_STRING_MAX) {
+            *out = (struct sylk_object){.type = SYLK_OBJ_STRING, .small = true, .small_length = length};
+            memset(out->small_value, 0, sizeof(out->small_value));
+
+            data = out->small_value;
+        } else {
+            struct sylk_string* string = string_alloc(vm, length);
+            CHECK_MEM(string);
+
+            *out = (struct sylk_object){.type = SYLK_OBJ_STRING, .str_value = string};
+            data = string->data;
+        }
+
+        memcpy(data, string_flat_chars(s1), length1);
+        memcpy(data + length1, string_flat_chars(s2), length2);
+
+        return 0;
+    }
+
+    struct sylk_string* string = gc_alloc(vm, GC_OBJ_ROPE, ROPE_OFFSET + sizeof(struct sylk_rope));
+    CHECK_MEM(string);
+
+    *string = (struct sylk_string) {
+        .length = length,
+        .rope = true
+    };
+
+    // small strings are copied in the rope
+    *rope_of(string) = (struct sylk_rope) {
+        .left = *s1,
+        .right = *s2
+    };
+
+    *out = (struct sylk_object){.type = SYLK_OBJ_STRING, .str_value = string};
+    return 0;
+}
+
+int string_compare(struct sylk_vm* vm, const struct sylk_object* s1, const struct sylk_object* s2, bool* out_equal) {
+    *out_equal = false;
+
+    // ropes are flattened only when the lengths can't tell the strings apart
+    uint32_t length = string_length(s1);
+    if (length != string_length(s2))
+        return 0;
+
+    if (!s1->small && !s2->small) {
+        if (s1->str_value == s2->str_value) {
+            *out_equal = true;
+            return 0;
+        }
+
+        // there is only one interned copy of every string
+        if (s1->str_value->interned && s2->str_value->interned)
+            return 0;
+    }
+
+    const char* chars1 = string_chars(vm, s1);
+    CHECK_MEM(chars1);
+
+    const char* chars2 = string_chars(vm, s2);
+    CHECK_MEM(chars2);
+
+    *out_equal = memcmp(chars1, chars2, length) == 0;
+    return 0;
+}
+
+static bool is_flattened(const struct sylk_rope* rope) {
+    return rope->right.type != SYLK_OBJ_STRING;
+}
+
+static int push_part(const struct sylk_object*** parts, uint32_t* n_parts, uint32_t* allocated, const struct sylk_object* part) {
+    if (*n_parts >= *allocated) {
+        uint32_t new_size = *allocated ? *allocated * 2 : 64;
+
+        const struct sylk_object** new_parts = realloc(*parts, new_size * sizeof(*new_parts));
+        CHECK_MEM(new_parts);
+
+        *parts = new_parts;
+        *allocated = new_size;
+    }
+
+    (*parts)[(*n_parts)++] = part;
+    return 0;
+}
+
+struct sylk_string* string_flatten(struct sylk_vm* vm, struct sylk_string* string) {
+    if (!string->rope)
+        return string;
+
+    struct sylk_rope* rope = rope_of(string);
+    if (is_flattened(rope))
+        return rope->left.str_value;
+
+    struct sylk_string* flat = string_alloc(vm, string->length);
+    if (!flat)
+        return NULL;
+
+    // the parts are copied from the end, so appending in a loop doesn't go deeper in the stack
+    const struct sylk_object** parts = NULL;
+    uint32_t n_parts = 0;
+    uint32_t allocated = 0;
+
+    uint32_t end = string->length;
+
+    const struct sylk_object* part = &(struct sylk_object){.type = SYLK_OBJ_STRING, .str_value = string};
+    while (part) {
+        if (!part->small && part->str_value->rope) {
+            struct sylk_rope* part_rope = rope_of(part->str_value);
+
+            if (is_flattened(part_rope)) {
+                part = &part_rope->left;
+                continue;
+            }
+
+            if (push_part(&parts, &n_parts, &allocated, &part_rope->left) != 0) {
+                free(parts);
+                return NULL;
+            }
+
+            part = &part_rope->right;
+            continue;
+        }
+
+        uint32_t length = string_length(part);
+
+        end -= length;
+        memcpy(flat->data + end, string_flat_chars(part), length);
+
+        part = n_parts > 0 ? parts[--n_parts] : NULL;
+    }
+
+    free(parts);
+
+    rope->left = (struct sylk_object){.type = SYLK_OBJ_STRING, .str_value = flat};
+    rope->right = (struct sylk_object){};
+    gc_write_barrier(vm, string, &rope->left);
+
+    return flat;
+}
+
+uint32_t hash_chars(const char* chars, uint32_t length) {
+    uint32_t hash = 2166136261u;
+    for (uint32_t i = 0; i < length; ++i) {
+        hash = (hash ^ (uint8_t)chars[i]) * 16777619u;
+    }
+
+    // 0 marks a hash that was not computed yet
+    return hash ? hash : 1;
+}
+
+uint32_t string_hash(struct sylk_string* string) {
+    if (!string->hash)
+        string->hash = hash_chars(string->data, string->length);
+
+    return string->hash;
+}
+
+bool string_equal_chars(const struct sylk_string* string, const char* chars) {
+    // stops at the end of the shorter string
+    return strncmp(string->data, chars, string->length) == 0 && chars[string->length] == '\0';
+}
@@ -0,0 +1,160 @@
+#ifndef SYLK_STRING_H_
+#define SYLK_STRING_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "objects.h"
+
+// bytes of a string with "length" characters, with its terminator
+#define sylk_string_size(length) \
+    (sizeof(struct sylk_string) + (length) + 1)
+
+// shorter concatenations are copied right away
+#define ROPE_MIN_LENGTH 64
+
+/**
+ * concatenation that is copied only when its bytes are needed
+ *
+ * @field left first string, or the flat copy of the rope once it is flattened
+ * @field right second string, not a string once the rope is flattened
+ */
+struct sylk_rope {
+    struct sylk_object left;
+    struct sylk_object right;
+};
+
+// the children are stored after the string header, aligned for the pointers
+#define ROPE_OFFSET \
+    ((sizeof(struct sylk_string) + 7) & ~(size_t)7)
+
+#define rope_of(string) \
+    ((struct sylk_rope*)((uint8_t*)(string) + ROPE_OFFSET))
+
+/**
+ * allocate a string managed by the gc, the characters are filled by the caller
+ *
+ * @param vm virtual machine
+ * @param length characters count
+ *
+ * @return string or NULL on failure
+ */
+struct sylk_string* string_alloc(struct sylk_vm* vm, uint32_t length);
+
+/**
+ * allocate a string managed by the gc with a copy of the characters
+ *
+ * @param vm virtual machine
+ * @param chars characters, they don't need a terminator
+ * @param length characters count
+ *
+ * @return string or NULL on failure
+ */
+struct sylk_string* string_new(struct sylk_vm* vm, const char* chars, uint32_t length);
+
+/**
+ * make a string object, short strings are stored in the object without an allocation
+ *
+ * @param vm virtual machine
+ * @param chars characters, they don't need a terminator
+ * @param length characters count
+ * @param out string object
+ *
+ * @return success code
+ */
+int string_object(struct sylk_vm* vm, const char* chars, uint32_t length, struct sylk_object* out);
+
+/**
+ * get the characters count of a string object
+ *
+ * @param string small string, string or rope
+ *
+ * @return characters count
+ */
+uint32_t string_length(const struct sylk_object* string);
+
+/**
+ * get the characters of a string object that is not a rope
+ *
+ * @param string small or flat string
+ *
+ * @return characters followed by a '\0'
+ */
+const char* string_flat_chars(const struct sylk_object* string);
+
+/**
+ * get the characters of any string object, ropes are flattened first
+ *
+ * @param vm virtual machine
+ * @param string small string, string or rope
+ *
+ * @return characters followed by a '\0' or NULL on failure
+ */
+const char* string_chars(struct sylk_vm* vm, const struct sylk_object* string);
+
+/**
+ * concatenate two strings, long results are ropes so appending in a loop doesn't copy
+ * the whole string every time
+ *
+ * @param vm virtual machine
+ * @param s1 first string
+ * @param s2 second string
+ * @param out new string
+ *
+ * @return success code
+ */
+int string_concat(struct sylk_vm* vm, const struct sylk_object* s1, const struct sylk_object* s2, struct sylk_object* out);
+
+/**
+ * compare the characters of two string objects of any kind
+ *
+ * @param vm virtual machine
+ * @param s1 first string
+ * @param s2 second string
+ * @param out_equal set to true if the strings are equal
+ *
+ * @return success code
+ */
+int string_compare(struct sylk_vm* vm, const struct sylk_object* s1, const struct sylk_object* s2, bool* out_equal);
+
+/**
+ * get a string with the bytes of a rope, the copy is made once and kept by the rope,
+ * must be called before reading the data of a string that may be a rope
+ *
+ * @param vm virtual machine
+ * @param string string or rope
+ *
+ * @return flat string or NULL on failure
+ */
+struct sylk_string* string_flatten(struct sylk_vm* vm, struct sylk_string* string);
+
+/**
+ * hash characters the same way as the strings
+ *
+ * @param chars characters
+ * @param length characters count
+ *
+ * @return hash, never 0
+ */
+uint32_t hash_chars(const char* chars, uint32_t length);
+
+/**
+ * get the hash of a flat string, it is computed on the first call
+ *
+ * @param string string
+ *
+ * @return hash
+ */
+uint32_t string_hash(struct sylk_string* string);
+
+/**
+ * compare a flat string with a C string
+ *
+ * @param string string
+ * @param chars characters terminated with a '\0'
+ *
+ * @return true if the strings are equal
+ */
+bool string_equal_chars(const struct sylk_string* string, const char* chars);
+
+#endif
@@ -1,3 +1,4 @@
+#include <inttypes.h>
 #include <stdio.h>
 #include "parser.h"
 #include "utils.h"
@@ -39,7 +40,14 @@ const char* rev_tokens[] = {
     "false",
     ".",
     "var",
-    "class"
+    "class",
+    "const",
+    "export",
+    "import",
+    "for",
+    "in",
+    "memo",
+    "float"
 };
 
 static const char* rev_node[] = {
@@ -67,7 +75,11 @@ static const char* rev_node[] = {
     "MEMBER",
     "CLASS",
     "BLOCK",
-    "METHOD_FUN"
+    "METHOD_FUN",
+    "CONSTANT",
+    "EXPORT",
+    "IMPORT",
+    "FOR"
 };
 
 static const char* rev_instruction[] = {
@@ -101,6 +113,13 @@ static const char* rev_instruction[] = {
     "PUSH_NUM",
     "GET_FIELD",
     "SET_FIELD",
+    "IMPORT",
+    "FOR_ITER",
+    "INDEX_GET",
+    "INDEX_SET",
+    "MEMO_GET",
+    "MEMO_RET",
+    "HALT"
 };
 
 const char* rev_objects[] = {
@@ -110,7 +129,8 @@ const char* rev_objects[] = {
     "OBJ_USER",
     "OBJ_FUNCTION",
     "OBJ_INSTANCE",
-    "OBJ_CLASS"
+    "OBJ_CLASS",
+    "OBJ_FLOAT"
 };
 
 void disassembly(const uint8_t* bytes, uint32_t n_bytes, uint32_t start_address) {
@@ -135,6 +155,16 @@ void disassembly(const uint8_t* bytes, uint32_t n_bytes, uint32_t start_address)
                 printf(" %d", start_address + *((uint32_t*)&bytes[i + 1]));
                 i += sizeof(uint32_t);
                 break;
+
+            case MEMO_GET:
+                printf(" %d %d", *((uint32_t*)&bytes[i + 1]), *((uint32_t*)&bytes[i + 5]));
+                i += 2 * sizeof(uint32_t);
+                break;
+
+            case FOR_ITER:
+                printf(" %d %d %d", *((uint32_t*)&bytes[i + 1]), start_address + *((uint32_t*)&bytes[i + 5]), start_address + *((uint32_t*)&bytes[i + 9]));
+                i += 3 * sizeof(uint32_t);
+                break;
         }
 
         printf("\n");
@@ -158,8 +188,10 @@ void dump_ast(struct node* root, int indent) {
 
     printf("%s", rev_node[root->type]);
 
-    if (root->type == NODE_NUMBER) {
-        printf("(%d)\n", *(int*)root->token.value);
+    if (root->type == NODE_NUMBER && root->token.code == TOK_FLT) {
+        printf("(%g)\n", root->token.float_value);
+    } else if (root->type == NODE_NUMBER) {
+        printf("(%" PRId64 ")\n", root->token.int_value);
     } else if (root->token.code != TOK_INV) {
         if (root->token.value) {
             printf("(%s)\n", (char*)root->token.value);
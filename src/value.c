@@ -0,0 +1,13 @@
+#include "value.h"
+
+#include "utils.h"
+
+int value_box_int64(struct sylk_vm* vm, int64_t number, sylk_value* out_value) {
+    int64_t* box = gc_alloc(vm, GC_OBJ_INT64, sizeof(*box));
+    CHECK_MEM(box);
+
+    *box = number;
+    *out_value = VALUE_NAN_BITS | value_tag_bits(VALUE_TAG_INT64) | (uintptr_t)box;
+
+    return 0;
+}
@@ -0,0 +1,232 @@
+#ifndef VALUE_H_
+#define VALUE_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#include "gc.h"
+#include "objects.h"
+
+/*
+ * a value is either a double or a quiet NaN with a tag in the sign bit and in the 3 bits
+ * below the quiet bit and a payload in the low 48 bits, the pointers of the user space fit
+ * in the payload on every 64 bits platform we support
+ */
+#define VALUE_NAN_BITS     0x7ff8000000000000ull
+#define VALUE_PAYLOAD_BITS 0x0000ffffffffffffull
+
+// the tags of the objects are their type plus one, 0 is the NaN of the arithmetic
+#define VALUE_TAG_SMALL_STRING 8
+
+// integers that don't fit in the payload are allocated by the gc
+#define VALUE_TAG_INT64 9
+
+#define value_tag_bits(tag) \
+    ((((uint64_t)(tag) & 8) << 60) | (((uint64_t)(tag) & 7) << 48))
+
+#define value_tag(value) \
+    ((uint32_t)((((value) >> 60) & 8) | (((value) >> 48) & 7)))
+
+#define value_payload(value) \
+    ((value) & VALUE_PAYLOAD_BITS)
+
+// characters count of a small string is stored in the last byte of the payload
+#define VALUE_SMALL_LENGTH_SHIFT 40
+
+#define VALUE_INT_MIN (-((int64_t)1 << 47))
+#define VALUE_INT_MAX (((int64_t)1 << 47) - 1)
+
+static inline bool value_is_float(sylk_value value) {
+    return (value & VALUE_NAN_BITS) != VALUE_NAN_BITS || value == VALUE_NAN_BITS;
+}
+
+// only the integers stored in the payload
+static inline bool value_is_int(sylk_value value) {
+    return !value_is_float(value) && value_tag(value) == SYLK_OBJ_NUMBER + 1;
+}
+
+static inline bool value_is_number(sylk_value value) {
+    return value_is_float(value) || value_tag(value) == SYLK_OBJ_NUMBER + 1 || value_tag(value) == VALUE_TAG_INT64;
+}
+
+static inline double value_float(sylk_value value) {
+    double number;
+    memcpy(&number, &value, sizeof(number));
+
+    return number;
+}
+
+static inline int64_t value_int(sylk_value value) {
+    // the payload is sign extended
+    return (int64_t)(value << 16) >> 16;
+}
+
+static inline sylk_value value_from_float(double number) {
+    // every NaN has the same bits, so none of them looks like a tagged value
+    if (number != number)
+        return VALUE_NAN_BITS;
+
+    sylk_value value;
+    memcpy(&value, &number, sizeof(value));
+
+    return value;
+}
+
+/**
+ * store an integer that doesn't fit in the payload of a value
+ *
+ * @param vm virtual machine
+ * @param number integer
+ * @param out_value value referring to a copy of the integer allocated by the gc
+ *
+ * @return success code
+ */
+int value_box_int64(struct sylk_vm* vm, int64_t number, sylk_value* out_value);
+
+// only for the integers known to fit in the payload, like addresses and positions
+static inline sylk_value value_from_small_int(int64_t number) {
+    return VALUE_NAN_BITS | value_tag_bits(SYLK_OBJ_NUMBER + 1) | ((uint64_t)number & VALUE_PAYLOAD_BITS);
+}
+
+static inline int value_from_int(struct sylk_vm* vm, int64_t number, sylk_value* out_value) {
+    if (number < VALUE_INT_MIN || number > VALUE_INT_MAX)
+        return value_box_int64(vm, number, out_value);
+
+    *out_value = value_from_small_int(number);
+    return 0;
+}
+
+/**
+ * store an object that is not an integer, it never allocates
+ *
+ * @param o object
+ *
+ * @return value
+ */
+static inline sylk_value value_box_object(struct sylk_object o) {
+    uint64_t payload;
+    uint32_t tag = o.type + 1;
+
+    switch (o.type) {
+        case SYLK_OBJ_FLOAT:
+            return value_from_float(o.float_value);
+
+        case SYLK_OBJ_BOOL:
+            payload = o.bool_value;
+            break;
+
+        case SYLK_OBJ_STRING:
+            if (o.small) {
+                tag = VALUE_TAG_SMALL_STRING;
+                payload = (uint64_t)o.small_length << VALUE_SMALL_LENGTH_SHIFT;
+
+                for (uint32_t i = 0; i < o.small_length; ++i) {
+                    payload |= (uint64_t)(uint8_t)o.small_value[i] << (i * 8);
+                }
+
+                break;
+            }
+
+            payload = (uintptr_t)o.str_value;
+            break;
+
+        default:
+            payload = (uintptr_t)o.obj_value;
+            break;
+    }
+
+    return VALUE_NAN_BITS | value_tag_bits(tag) | payload;
+}
+
+/**
+ * store an object in a value
+ *
+ * @param vm virtual machine, big integers are allocated in its heap
+ * @param o object
+ * @param out_value value
+ *
+ * @return success code
+ */
+static inline int value_box(struct sylk_vm* vm, struct sylk_object o, sylk_value* out_value) {
+    if (o.type == SYLK_OBJ_NUMBER)
+        return value_from_int(vm, o.num_value, out_value);
+
+    *out_value = value_box_object(o);
+    return 0;
+}
+
+/**
+ * load the object stored in a value
+ *
+ * @param value value
+ *
+ * @return object
+ */
+static inline struct sylk_object value_unbox(sylk_value value) {
+    if (value_is_float(value))
+        return (struct sylk_object){.type = SYLK_OBJ_FLOAT, .float_value = value_float(value)};
+
+    uint32_t tag = value_tag(value);
+    uint64_t payload = value_payload(value);
+
+    switch (tag) {
+        case SYLK_OBJ_NUMBER + 1:
+            return (struct sylk_object){.type = SYLK_OBJ_NUMBER, .num_value = value_int(value)};
+
+        case VALUE_TAG_INT64:
+            return (struct sylk_object){.type = SYLK_OBJ_NUMBER, .num_value = *(int64_t*)(uintptr_t)payload};
+
+        case SYLK_OBJ_BOOL + 1:
+            return (struct sylk_object){.type = SYLK_OBJ_BOOL, .bool_value = payload != 0};
+
+        case VALUE_TAG_SMALL_STRING:
+            {
+                struct sylk_object o = {.type = SYLK_OBJ_STRING, .small = true, .small_length = payload >> VALUE_SMALL_LENGTH_SHIFT};
+                memset(o.small_value, 0, sizeof(o.small_value));
+
+                for (uint32_t i = 0; i < o.small_length; ++i) {
+                    o.small_value[i] = (char)(payload >> (i * 8));
+                }
+
+                return o;
+            }
+
+        default:
+            return (struct sylk_object){.type = tag - 1, .obj_value = (void*)(uintptr_t)payload};
+    }
+}
+
+/**
+ * get the object of a value the way the gc sees it, a big integer is the object
+ * that holds it instead of a number
+ *
+ * @param value value
+ *
+ * @return object
+ */
+static inline struct sylk_object value_gc_object(sylk_value value) {
+    if (!value_is_float(value) && value_tag(value) == VALUE_TAG_INT64)
+        return (struct sylk_object){.type = GC_OBJ_INT64, .obj_value = (void*)(uintptr_t)value_payload(value)};
+
+    return value_unbox(value);
+}
+
+/**
+ * call an object callback with the object of a value, the value is updated if the
+ * callback moves the object it refers to, like the gc does with the young objects
+ *
+ * @param value value
+ * @param cb callback
+ * @param ctx context passed to the callback
+ */
+static inline void value_visit(sylk_value* value, sylk_object_callback cb, void* ctx) {
+    struct sylk_object o = value_gc_object(*value);
+    void* object = o.obj_value;
+
+    cb(&o, ctx);
+
+    if (o.obj_value != object)
+        *value = (*value & ~VALUE_PAYLOAD_BITS) | (uintptr_t)o.obj_value;
+}
+
+#endif
@@ -1,3 +1,4 @@
+#include <inttypes.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
@@ -13,56 +14,83 @@
 #include "gc.h"
 #include "objects.h"
 #include "operations.h"
+#include "sylk.h"
 #include "sylk_lib.h"
+#include "sylk_string.h"
+#include "stdlib/classes.h"
 
-static void push_number(struct sylk_vm* vm, int32_t number) {
-    vm->stack[vm->stack_size++] = (struct sylk_object){.type = SYLK_OBJ_NUMBER, .num_value = number};
+static int push_number(struct sylk_vm* vm, int64_t number) {
+    sylk_value value;
+    CHECK(value_from_int(vm, number, &value), "failed to store integer");
+
+    push_value(value);
+    return 0;
+}
+
+// the stack bases and the addresses always fit in a value
+static void push_small_number(struct sylk_vm* vm, int64_t number) {
+    vm->stack[vm->stack_size++] = value_from_small_int(number);
+}
+
+static void push_float(struct sylk_vm* vm, double number) {
+    vm->stack[vm->stack_size++] = value_from_float(number);
 }
 
-static void push_string(struct sylk_vm* vm, char* string) {
-    vm->stack[vm->stack_size++] = (struct sylk_object){.type = SYLK_OBJ_STRING, .str_value = string};
+static void push_string(struct sylk_vm* vm, struct sylk_string* string) {
+    vm->stack[vm->stack_size++] = value_box_object((struct sylk_object){.type = SYLK_OBJ_STRING, .str_value = string});
 }
 
 static void push_bool(struct sylk_vm* vm, bool value) {
-    vm->stack[vm->stack_size++] = (struct sylk_object){.type = SYLK_OBJ_BOOL, .bool_value = value};
+    vm->stack[vm->stack_size++] = value_box_object((struct sylk_object){.type = SYLK_OBJ_BOOL, .bool_value = value});
 }
 
 static void push_func(struct sylk_vm* vm, struct sylk_object_function* func) {
-    vm->stack[vm->stack_size++] = (struct sylk_object){.type = SYLK_OBJ_FUNCTION, .obj_value = func};
+    vm->stack[vm->stack_size++] = value_box_object((struct sylk_object){.type = SYLK_OBJ_FUNCTION, .obj_value = func});
 }
 
 static void push_class(struct sylk_vm* vm, struct sylk_object_class* cls) {
-    vm->stack[vm->stack_size++] = (struct sylk_object){.type = SYLK_OBJ_CLASS, .obj_value = cls};
+    vm->stack[vm->stack_size++] = value_box_object((struct sylk_object){.type = SYLK_OBJ_CLASS, .obj_value = cls});
 }
 
-static void push_constant(struct sylk_vm* vm, int32_t address) {
+static int push_constant(struct sylk_vm* vm, int32_t address) {
     int type = *((int32_t*)&vm->bytes[address]);
     address += sizeof(int32_t);
 
-    void* value;
     if (type == SYLK_OBJ_NUMBER) {
-        int32_t number = *((int32_t*)&vm->bytes[address]);
-        push_number(vm, number);
-        return;
+        int64_t number;
+        memcpy(&number, &vm->bytes[address], sizeof(number));
+
+        CHECK(push_number(vm, number), "failed to push integer");
+        return 0;
+    }
+
+    if (type == SYLK_OBJ_FLOAT) {
+        double number;
+        memcpy(&number, &vm->bytes[address], sizeof(number));
+
+        push_float(vm, number);
+        return 0;
     }
 
     if (type == SYLK_OBJ_STRING) {
-        value = &vm->bytes[address];
-        push_string(vm, value);
-        return;
+        push_string(vm, *(struct sylk_string**)&vm->bytes[address]);
+        return 0;
     }
 
     if (type == SYLK_OBJ_FUNCTION) {
         struct sylk_object_function* func = (struct sylk_object_function*)&vm->bytes[address];
         push_func(vm, func);
-        return;
+        return 0;
     }
 
     if (type == SYLK_OBJ_CLASS) {
         struct sylk_object_class* cls = (struct sylk_object_class*)&vm->bytes[address];
         push_class(vm, cls);
-        return;
+        return 0;
     }
+
+    ERROR("constant of type %d can't be pushed", type);
+    return 1;
 }
 
 static int32_t pop_number(struct sylk_vm* vm) {
@@ -70,15 +98,59 @@ static int32_t pop_number(struct sylk_vm* vm) {
     return obj.num_value;
 }
 
-static int pop_number_check(struct sylk_vm* vm, int32_t* out_number) {
-    struct sylk_object obj = pop();
-    EXPECT_OBJECT(obj.type, SYLK_OBJ_NUMBER);
+/**
+ * operands of an arithmetic instruction, both integers or both doubles
+ *
+ * @field is_float true if the doubles are set
+ * @field int1 first integer
+ * @field int2 second integer
+ * @field float1 first double
+ * @field float2 second double
+ */
+struct numbers {
+    bool is_float;
+
+    int64_t int1;
+    int64_t int2;
+
+    double float1;
+    double float2;
+};
+
+// an integer operand is converted to a double when the other one is a double
+static int pop_numbers(struct sylk_vm* vm, struct numbers* out) {
+    sylk_value value1 = pop_value();
+    sylk_value value2 = pop_value();
+
+    // the common cases are read from the values without building the objects
+    if (value_is_int(value1) && value_is_int(value2)) {
+        *out = (struct numbers){.int1 = value_int(value1), .int2 = value_int(value2)};
+        return 0;
+    }
+
+    if (value_is_float(value1) && value_is_float(value2)) {
+        *out = (struct numbers){.is_float = true, .float1 = value_float(value1), .float2 = value_float(value2)};
+        return 0;
+    }
+
+    struct sylk_object o1 = value_unbox(value1);
+    struct sylk_object o2 = value_unbox(value2);
+
+    if (!is_number(&o1) || !is_number(&o2)) {
+        ERROR("expected numbers, got object types %s and %s", rev_objects[o1.type], rev_objects[o2.type]);
+        return 1;
+    }
 
-    *out_number = obj.num_value;
+    if (o1.type == SYLK_OBJ_NUMBER && o2.type == SYLK_OBJ_NUMBER) {
+        *out = (struct numbers){.int1 = o1.num_value, .int2 = o2.num_value};
+        return 0;
+    }
+
+    *out = (struct numbers){.is_float = true, .float1 = number_as_float(&o1), .float2 = number_as_float(&o2)};
     return 0;
 }
 
-static const char* pop_string(struct sylk_vm* vm) {
+static const struct sylk_string* pop_string(struct sylk_vm* vm) {
     struct sylk_object obj = pop();
     return obj.str_value;
 }
@@ -96,17 +168,20 @@ int pop_bool_check(struct sylk_vm* vm, bool* out_bool) {
     return 0;
 }
 
-static void ret(struct sylk_vm* vm) {
-    struct sylk_object return_val = pop();
-
+static void ret_value(struct sylk_vm* vm, sylk_value return_val) {
     vm->stack_size = vm->stack_base;
     int32_t index = pop_number(vm);
     vm->stack_base = pop_number(vm);
 
-    push(return_val);
+    push_value(return_val);
     vm->program_counter = index - 1;
 }
 
+static void ret(struct sylk_vm* vm) {
+    sylk_value return_val = pop_value();
+    ret_value(vm, return_val);
+}
+
 #define read_value(value_type) \
     (*((value_type*)(vm->bytes + vm->program_counter + 1)))
 
@@ -114,25 +189,31 @@ static void ret(struct sylk_vm* vm) {
     (*((value_type*)(vm->bytes + vm->program_counter + 1))); vm->program_counter += sizeof(value_type)
 
 int execute(struct sylk* s, struct sylk_vm* vm){
-    (void) s;
     vm->program_counter = vm->start_address;
 
-    // run gc at this number of allocated objects
-    vm->gc.treshold = 1;
+    vm->gc.growth_factor = s->config->gc_growth_factor > 0 ? s->config->gc_growth_factor : GC_DEFAULT_GROWTH_FACTOR;
+    vm->gc.mark_budget = s->config->gc_mark_budget;
+    vm->gc.n_threads = s->config->gc_threads;
+    vm->gc.callback = s->config->gc_callback;
+    vm->gc.callback_ctx = s->ctx;
 
     while (!vm->halt && vm->program_counter < vm->n_bytes) {
+        // between instructions every live object is on the stack
+        if (vm->gc.collect)
+            gc_clean(vm);
+
         switch (vm->bytes[vm->program_counter]) {
             case PUSH:
                 {
                     int32_t constant = read_value_increment(int32_t);
-                    push_constant(vm, constant);
+                    CHECK(push_constant(vm, constant), "failed to push constant");
                 }
                 break;
 
             case PUSH_NUM:
                 {
                     int32_t number = read_value_increment(int32_t);
-                    push_number(vm, number);
+                    push_small_number(vm, number);
                 }
                 break;
 
@@ -154,6 +235,20 @@ int execute(struct sylk* s, struct sylk_vm* vm){
 
             case ADD:
                 {
+                    // numbers don't go through the operations table
+                    if (value_is_number(peek_value(0)) && value_is_number(peek_value(1))) {
+                        struct numbers n;
+                        CHECK(pop_numbers(vm, &n), "invalid operands for add operation");
+
+                        if (n.is_float) {
+                            push_float(vm, n.float1 + n.float2);
+                        } else {
+                            CHECK(push_number(vm, (int64_t)((uint64_t)n.int1 + (uint64_t)n.int2)), "failed to push integer");
+                        }
+
+                        break;
+                    }
+
                     struct sylk_object value1 = pop();
                     struct sylk_object value2 = pop();
 
@@ -169,37 +264,51 @@ int execute(struct sylk* s, struct sylk_vm* vm){
 
             case MIN:
                 {
-                    int32_t number1;
-                    CHECK(pop_number_check(vm, &number1), "operand 1 for minus operation is not a number");
-
-                    int32_t number2;
-                    CHECK(pop_number_check(vm, &number2), "operand 2 for minus operation is not a number");
+                    struct numbers n;
+                    CHECK(pop_numbers(vm, &n), "invalid operands for minus operation");
 
-                    push_number(vm, number1 - number2);
+                    if (n.is_float) {
+                        push_float(vm, n.float1 - n.float2);
+                    } else {
+                        CHECK(push_number(vm, (int64_t)((uint64_t)n.int1 - (uint64_t)n.int2)), "failed to push integer");
+                    }
                 }
                 break;
 
             case MUL:
                 {
-                    int32_t number1;
-                    CHECK(pop_number_check(vm, &number1), "operand 1 for multiply operation is not a number");
+                    struct numbers n;
+                    CHECK(pop_numbers(vm, &n), "invalid operands for multiply operation");
 
-                    int32_t number2;
-                    CHECK(pop_number_check(vm, &number2), "operand 2 for multiply operation is not a number");
-
-                    push_number(vm, number1 * number2);
+                    if (n.is_float) {
+                        push_float(vm, n.float1 * n.float2);
+                    } else {
+                        CHECK(push_number(vm, (int64_t)((uint64_t)n.int1 * (uint64_t)n.int2)), "failed to push integer");
+                    }
                 }
                 break;
 
             case DIV:
                 {
-                    int32_t number1;
-                    CHECK(pop_number_check(vm, &number1), "operand 1 for division operation is not a number");
+                    struct numbers n;
+                    CHECK(pop_numbers(vm, &n), "invalid operands for division operation");
+
+                    if (n.is_float) {
+                        push_float(vm, n.float1 / n.float2);
+                        break;
+                    }
 
-                    int32_t number2;
-                    CHECK(pop_number_check(vm, &number2), "operand 2 for division operation is not a number");
+                    if (n.int2 == 0) {
+                        ERROR("division by zero");
+                        return 1;
+                    }
 
-                    push_number(vm, number1 / number2);
+                    // the only quotient that overflows wraps around like the other operations
+                    if (n.int2 == -1) {
+                        CHECK(push_number(vm, (int64_t)(0 - (uint64_t)n.int1)), "failed to push integer");
+                    } else {
+                        CHECK(push_number(vm, n.int1 / n.int2), "failed to push integer");
+                    }
                 }
                 break;
 
@@ -214,6 +323,15 @@ int execute(struct sylk* s, struct sylk_vm* vm){
 
             case DEQ:
                 {
+                    // integers in the values are equal when their bits are equal
+                    if (value_is_int(peek_value(0)) && value_is_int(peek_value(1))) {
+                        sylk_value value1 = pop_value();
+                        sylk_value value2 = pop_value();
+
+                        push_bool(vm, value1 == value2);
+                        break;
+                    }
+
                     struct sylk_object exp1 = pop();
                     struct sylk_object exp2 = pop();
 
@@ -229,6 +347,15 @@ int execute(struct sylk* s, struct sylk_vm* vm){
 
             case NEQ:
                 {
+                    // integers in the values are equal when their bits are equal
+                    if (value_is_int(peek_value(0)) && value_is_int(peek_value(1))) {
+                        sylk_value value1 = pop_value();
+                        sylk_value value2 = pop_value();
+
+                        push_bool(vm, value1 != value2);
+                        break;
+                    }
+
                     struct sylk_object exp1 = pop();
                     struct sylk_object exp2 = pop();
 
@@ -245,49 +372,37 @@ int execute(struct sylk* s, struct sylk_vm* vm){
 
             case GRE:
                 {
-                    int32_t number1;
-                    CHECK(pop_number_check(vm, &number1), "operand 1 for greater operation is not a number");
+                    struct numbers n;
+                    CHECK(pop_numbers(vm, &n), "invalid operands for greater operation");
 
-                    int32_t number2;
-                    CHECK(pop_number_check(vm, &number2), "operand 2 for greater operation is not a number");
-
-                    push_bool(vm, number1 > number2);
+                    push_bool(vm, n.is_float ? n.float1 > n.float2 : n.int1 > n.int2);
                 }
                 break;
 
             case GRQ:
                 {
-                    int32_t number1;
-                    CHECK(pop_number_check(vm, &number1), "operand 1 for greater or equal operation is not a number");
-
-                    int32_t number2;
-                    CHECK(pop_number_check(vm, &number2), "operand 2 for greater or equal operation is not a number");
+                    struct numbers n;
+                    CHECK(pop_numbers(vm, &n), "invalid operands for greater or equal operation");
 
-                    push_bool(vm, number1 >= number2);
+                    push_bool(vm, n.is_float ? n.float1 >= n.float2 : n.int1 >= n.int2);
                 }
                 break;
 
             case LES:
                 {
-                    int32_t number1;
-                    CHECK(pop_number_check(vm, &number1), "operand 1 for less operation is not a number");
-
-                    int32_t number2;
-                    CHECK(pop_number_check(vm, &number2), "operand 2 for less operation is not a number");
+                    struct numbers n;
+                    CHECK(pop_numbers(vm, &n), "invalid operands for less operation");
 
-                    push_bool(vm, number1 < number2);
+                    push_bool(vm, n.is_float ? n.float1 < n.float2 : n.int1 < n.int2);
                 }
                 break;
 
             case LEQ:
                 {
-                    int32_t number1;
-                    CHECK(pop_number_check(vm, &number1), "operand 1 for less or equal operation is not a number");
+                    struct numbers n;
+                    CHECK(pop_numbers(vm, &n), "invalid operands for less or equal operation");
 
-                    int32_t number2;
-                    CHECK(pop_number_check(vm, &number2), "operand 2 for less or equal operation is not a number");
-
-                    push_bool(vm, number1 <= number2);
+                    push_bool(vm, n.is_float ? n.float1 <= n.float2 : n.int1 <= n.int2);
                 }
                 break;
 
@@ -318,26 +433,26 @@ int execute(struct sylk* s, struct sylk_vm* vm){
             case DUP:
                 {
                     int32_t index = read_value_increment(int32_t);
-                    push(vm->stack[index]);
+                    push_value(vm->stack[index]);
                 }
                 break;
 
             case DUP_LOC:
                 {
                     int32_t index = read_value_increment(int32_t);
-                    push(vm->stack[vm->stack_base + index]);
+                    push_value(vm->stack[vm->stack_base + index]);
                 }
                 break;
             case CHANGE:
                 {
                     int32_t index = read_value_increment(int32_t);
-                    vm->stack[index] = pop();
+                    vm->stack[index] = pop_value();
                 }
                 break;
             case CHANGE_LOC:
                 {
                     int32_t index = read_value_increment(int32_t);
-                    vm->stack[vm->stack_base + index] = pop();
+                    vm->stack[vm->stack_base + index] = pop_value();
                 }
                 break;
             case JMP_NOT:
@@ -360,17 +475,101 @@ int execute(struct sylk* s, struct sylk_vm* vm){
                 }
                 break;
 
+            case FOR_ITER:
+                {
+                    int32_t index = read_value_increment(int32_t);
+                    int32_t body = read_value_increment(int32_t);
+                    int32_t end = read_value_increment(int32_t);
+
+                    // iterable, position and loop variable are consecutive locals
+                    sylk_value* iterator = &vm->stack[vm->stack_base + index];
+
+                    struct sylk_object iterable = value_unbox(iterator[0]);
+                    struct list_context* list = get_list(&iterable);
+                    if (!list)
+                        break;
+
+                    uint32_t position = value_unbox(iterator[1]).num_value;
+                    if (position >= list->n_elements) {
+                        vm->program_counter = vm->start_address + end - 1;
+                        break;
+                    }
+
+                    iterator[1] = value_from_small_int(position + 1);
+                    iterator[2] = list->container[position];
+
+                    vm->program_counter = vm->start_address + body - 1;
+                }
+                break;
+
+            case INDEX_GET:
+                {
+                    struct sylk_object container = pop();
+                    struct sylk_object index = pop();
+
+                    struct list_context* list = get_list(&container);
+                    if (list) {
+                        EXPECT_OBJECT(index.type, SYLK_OBJ_NUMBER);
+                        if (index.num_value < 0 || (uint32_t)index.num_value >= list->n_elements) {
+                            ERROR("index %" PRId64 " out of range", index.num_value);
+                            return 1;
+                        }
+
+                        push_value(list->container[index.num_value]);
+                        break;
+                    }
+
+                    // user classes implement indexing with "__get"
+                    push_small_number(vm, vm->stack_base);
+                    push_small_number(vm, vm->program_counter + 1);
+                    push(index);
+
+                    CHECK(call_method(vm, &container, "__get", 1, s->ctx), "failed to index object of type: %s", rev_objects[container.type]);
+                }
+                break;
+
+            case INDEX_SET:
+                {
+                    struct sylk_object container = pop();
+                    struct sylk_object index = pop();
+                    sylk_value value = pop_value();
+
+                    struct list_context* list = get_list(&container);
+                    if (list) {
+                        EXPECT_OBJECT(index.type, SYLK_OBJ_NUMBER);
+                        if (index.num_value < 0 || (uint32_t)index.num_value >= list->n_elements) {
+                            ERROR("index %" PRId64 " out of range", index.num_value);
+                            return 1;
+                        }
+
+                        list->container[index.num_value] = value;
+                        gc_write_barrier_value(vm, container.obj_value, value);
+
+                        push_bool(vm, false);
+                        break;
+                    }
+
+                    // user classes implement indexing with "__set"
+                    push_small_number(vm, vm->stack_base);
+                    push_small_number(vm, vm->program_counter + 1);
+                    push_value(value);
+                    push(index);
+
+                    CHECK(call_method(vm, &container, "__set", 2, s->ctx), "failed to index object of type: %s", rev_objects[container.type]);
+                }
+                break;
+
             case PUSH_BASE:
                 {
                     uint32_t old_base = vm->stack_base;
-                    push_number(vm, old_base);
+                    push_small_number(vm, old_base);
                 }
                 break;
 
             case PUSH_ADDR:
                 {
                     int32_t addr = read_value_increment(int32_t);
-                    push_number(vm, vm->start_address + addr);
+                    push_small_number(vm, vm->start_address + addr);
                 }
                 break;
 
@@ -389,7 +588,7 @@ int execute(struct sylk* s, struct sylk_vm* vm){
 
             case GET_FIELD:
                 {
-                    const char* field_name = pop_string(vm);
+                    const struct sylk_string* field_name = pop_string(vm);
                     struct sylk_object instance = pop();
 
                     field_fun field_cb = get_table[instance.type];
@@ -401,7 +600,7 @@ int execute(struct sylk* s, struct sylk_vm* vm){
 
             case SET_FIELD:
                 {
-                    const char* field_name = pop_string(vm);
+                    const struct sylk_string* field_name = pop_string(vm);
                     struct sylk_object instance = pop();
 
                     field_fun field_cb = set_table[instance.type];
@@ -415,6 +614,52 @@ int execute(struct sylk* s, struct sylk_vm* vm){
                     ret(vm);
                 }
                 break;
+
+            case HALT:
+                {
+                    vm->halt = true;
+                }
+                break;
+
+            case MEMO_GET:
+                {
+                    int32_t cache = read_value_increment(int32_t);
+                    int32_t n_args = read_value_increment(int32_t);
+
+                    uint32_t capacity = s->config->memo_size ? s->config->memo_size : MEMO_DEFAULT_CAPACITY;
+
+                    // the cache reads the bytes of the string arguments
+                    for (int32_t i = 0; i < n_args; ++i) {
+                        sylk_value* arg = &vm->stack[vm->stack_base + i];
+
+                        struct sylk_object o = value_unbox(*arg);
+                        if (o.type == SYLK_OBJ_STRING && !o.small) {
+                            o.str_value = string_flatten(vm, o.str_value);
+                            CHECK_MEM(o.str_value);
+
+                            *arg = value_box_object(o);
+                        }
+                    }
+
+                    bool hit;
+                    struct sylk_object value;
+                    CHECK(memo_lookup(&vm->memos, cache, capacity, &vm->stack[vm->stack_base], n_args, &hit, &value), "failed to look up memoized call");
+
+                    if (hit) {
+                        sylk_value boxed;
+                        CHECK(value_box(vm, value, &boxed), "failed to return memoized result");
+                        ret_value(vm, boxed);
+                    }
+                }
+                break;
+
+            case MEMO_RET:
+                {
+                    struct sylk_object result = peek(0);
+                    CHECK(memo_store(&vm->memos, &result), "failed to store memoized result");
+                    ret(vm);
+                }
+                break;
         }
 
         ++vm->program_counter;
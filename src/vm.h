@@ -5,22 +5,45 @@
 #include <stddef.h>
 #include "compiler.h"
 #include "gc.h"
+#include "intern.h"
+#include "memo.h"
 #include "objects.h"
+#include "slab.h"
+#include "value.h"
 
+#define push_value(v) \
+    vm->stack[vm->stack_size++] = (v)
+
+#define pop_value() \
+    (vm->stack[--vm->stack_size])
+
+// integers wider than a value are allocated, so pushing an object can fail
 #define push(o) \
-    vm->stack[vm->stack_size++] = (o)
+{ \
+    sylk_value pushed_value; \
+    CHECK(value_box(vm, o, &pushed_value), "failed to push object"); \
+    push_value(pushed_value); \
+}
 
 #define pop() \
-    (vm->stack[--vm->stack_size])
+    value_unbox(pop_value())
 
-#define peek(n) \
+#define peek_value(n) \
     (vm->stack[vm->stack_size - 1 - (n)])
 
+#define peek(n) \
+    value_unbox(peek_value(n))
+
 struct sylk_vm {
-    struct sylk_object stack[2048];
+    sylk_value stack[2048];
 
     uint8_t* bytes;
     uint32_t n_bytes;
+    uint32_t capacity;
+
+    struct lazy_table* lazy;
+
+    struct intern_table* strings;
 
     uint32_t start_address;
 
@@ -29,8 +52,13 @@ struct sylk_vm {
     uint32_t program_counter;
 
     struct gc gc;
+    struct slab_allocator slab;
+
+    struct memo_table memos;
 
     bool halt;
+    // set by a built-in function that failed, the call stops the execution
+    bool builtin_failed;
 };
 
 struct sylk;
@@ -13,9 +13,10 @@ syn match SylkNumber '[-]\d\+' display
 
 syn keyword SylkDeclarations var class const nextgroup=SylkIdentifier skipwhite
 syn keyword SylkDeclarations def nextgroup=SylkFunction skipwhite
+syn keyword SylkDeclarations memo
 
 syn keyword SylkConditionals if else
-syn keyword SylkRepeats while
+syn keyword SylkRepeats while for in
 syn keyword SylkSpecial self
 syn keyword SylkKeywords return export import
 
@@ -1,19 +1,33 @@
 #include <gtest/gtest.h>
 #include <cstdint>
+#include <cstring>
+#include <string>
 #include <stdbool.h>
 
 extern "C" {
     #include "../src/parser.h"
 }
 
+// the nodes are released when the test returns
+struct arena_guard {
+    struct ast_arena arena;
+
+    ~arena_guard() {
+        ast_arena_free(&arena);
+    }
+};
+
 #define INIT() \
     struct lexer l = { \
         .text = input, \
         .text_size = sizeof(input) - 1, \
         .line = 1 \
     }; \
+    arena_guard guard = {}; \
     struct parser p = { \
-        .l = &l \
+        .l = &l, \
+        .strings = NULL, \
+        .arena = &guard.arena \
     }
 
 #define EXPECT_NODE(node, expected_type) \
@@ -46,7 +60,7 @@ TEST_PARSER(call) {
     struct node* var = call->left;
     EXPECT_NODE(var, NODE_VAR);
 
-    EXPECT_STREQ((const char*)var->token.value, "print");
+    EXPECT_STREQ(var->token.value, "print");
 
     struct node* argument = call->right;
     EXPECT_NODE(argument, NODE_ARGUMENT);
@@ -54,7 +68,7 @@ TEST_PARSER(call) {
     struct node* number = argument->left;
     EXPECT_NODE(number, NODE_NUMBER);
 
-    EXPECT_EQ(*((int32_t*)(number->token.value)), 10);
+    EXPECT_EQ(number->token.int_value, 10);
 }
 
 TEST_PARSER(declaration) {
@@ -72,7 +86,7 @@ TEST_PARSER(declaration) {
     struct node* declaration = statement->left;
     EXPECT_NODE(declaration, NODE_DECLARATION);
 
-    EXPECT_STREQ((const char*)declaration->token.value, "a");
+    EXPECT_STREQ(declaration->token.value, "a");
 }
 
 TEST_PARSER(initialization) {
@@ -90,12 +104,12 @@ TEST_PARSER(initialization) {
     struct node* declaration = statement->left;
     EXPECT_NODE(declaration, NODE_DECLARATION);
 
-    EXPECT_STREQ((const char*)declaration->token.value, "a");
+    EXPECT_STREQ(declaration->token.value, "a");
 
     struct node* init_value = declaration->left;
     EXPECT_NODE(init_value, NODE_STRING);
 
-    EXPECT_STREQ((const char*)init_value->token.value, "hello");
+    EXPECT_STREQ(init_value->token.value, "hello");
 }
 
 TEST_PARSER(assignment) {
@@ -117,7 +131,7 @@ TEST_PARSER(assignment) {
     struct node* variable = assignment->left;
     EXPECT_NODE(variable, NODE_VAR);
 
-    EXPECT_STREQ((const char*)variable->token.value, "a");
+    EXPECT_STREQ(variable->token.value, "a");
 
     struct node* init_value = assignment->right;
     EXPECT_NODE(init_value, NODE_BOOL);
@@ -147,11 +161,11 @@ TEST_PARSER(if) {
 
     struct node* variable = expression->left;
     EXPECT_NODE(variable, NODE_VAR);
-    EXPECT_STREQ((const char*)variable->token.value, "a");
+    EXPECT_STREQ(variable->token.value, "a");
 
     struct node* value = expression->right;
     EXPECT_NODE(value, NODE_NUMBER);
-    EXPECT_EQ(*((int32_t*)(value->token.value)), 10);
+    EXPECT_EQ(value->token.int_value, 10);
 
     struct node* decision = node_if->right;
     EXPECT_NODE(decision, NODE_DECISION);
@@ -185,11 +199,11 @@ TEST_PARSER(if_else) {
 
     struct node* variable = expression->left;
     EXPECT_NODE(variable, NODE_VAR);
-    EXPECT_STREQ((const char*)variable->token.value, "a");
+    EXPECT_STREQ(variable->token.value, "a");
 
     struct node* value = expression->right;
     EXPECT_NODE(value, NODE_STRING);
-    EXPECT_STREQ((const char*)value->token.value, "hello");
+    EXPECT_STREQ(value->token.value, "hello");
 
     struct node* decision = node_if->right;
     EXPECT_NODE(decision, NODE_DECISION);
@@ -222,7 +236,7 @@ TEST_PARSER(while) {
 
     struct node* variable = expression->left;
     EXPECT_NODE(variable, NODE_VAR);
-    EXPECT_STREQ((const char*)variable->token.value, "stop");
+    EXPECT_STREQ(variable->token.value, "stop");
 
     struct node* decision = whl->right;
     EXPECT_NODE(decision, NODE_DECISION);
@@ -246,15 +260,15 @@ TEST_PARSER(function) {
 
     struct node* function = statement->left;
     EXPECT_NODE(function, NODE_FUNCTION);
-    EXPECT_STREQ((const char*)function->token.value, "fun");
+    EXPECT_STREQ(function->token.value, "fun");
 
     struct node* parameter = function->left;
     EXPECT_NODE(parameter, NODE_PARAMETER);
-    EXPECT_STREQ((const char*)parameter->token.value, "b");
+    EXPECT_STREQ(parameter->token.value, "b");
 
     struct node* next_parameter = parameter->right;
     EXPECT_NODE(next_parameter, NODE_PARAMETER);
-    EXPECT_STREQ((const char*)next_parameter->token.value, "a");
+    EXPECT_STREQ(next_parameter->token.value, "a");
 
     struct node* body = function->right;
     EXPECT_NODE(body, NODE_BLOCK);
@@ -271,18 +285,18 @@ TEST_PARSER(function) {
 
     struct node* var1 = expression->left;
     EXPECT_NODE(var1, NODE_VAR);
-    EXPECT_STREQ((const char*)var1->token.value, "a");
+    EXPECT_STREQ(var1->token.value, "a");
 
     struct node* var2 = expression->right;
     EXPECT_NODE(var2, NODE_INDEX);
 
     struct node* from = var2->left;
     EXPECT_NODE(from, NODE_VAR);
-    EXPECT_STREQ((const char*)from->token.value, "b");
+    EXPECT_STREQ(from->token.value, "b");
 
     struct node* index_expr = var2->right;
     EXPECT_NODE(index_expr, NODE_NUMBER);
-    EXPECT_EQ(*((int32_t*)(index_expr->token.value)), -1);
+    EXPECT_EQ(index_expr->token.int_value, -1);
 }
 
 TEST_PARSER(class) {
@@ -305,18 +319,18 @@ TEST_PARSER(class) {
 
     struct node* cls = statement->left;
     EXPECT_NODE(cls, NODE_CLASS);
-    EXPECT_STREQ((const char*)cls->token.value, "Test");
+    EXPECT_STREQ(cls->token.value, "Test");
 
     struct node* member = cls->left;
     EXPECT_NODE(member, NODE_MEMBER);
-    EXPECT_STREQ((const char*)member->token.value, "a");
+    EXPECT_STREQ(member->token.value, "a");
 
     struct node* methods = cls->right;
     EXPECT_NODE(methods, NODE_METHODS);
 
     struct node* method = methods->left;
     EXPECT_NODE(method, NODE_METHOD);
-    EXPECT_STREQ((const char*)method->token.value, "get");
+    EXPECT_STREQ(method->token.value, "get");
 
     struct node* args = method->left;
     EXPECT_EQ(args, nullptr);
@@ -333,9 +347,38 @@ TEST_PARSER(class) {
     struct node* ret_val = ret->left;
     EXPECT_NODE(ret_val, NODE_MEMBER_ACCESS);
 
-    EXPECT_STREQ((const char*)ret_val->token.value, "a");
+    EXPECT_STREQ(ret_val->token.value, "a");
 
     struct node* from = ret_val->left;
     EXPECT_NODE(from, NODE_VAR);
-    EXPECT_STREQ((const char*)from->token.value, "self");
+    EXPECT_STREQ(from->token.value, "self");
+}
+
+TEST_PARSER(long_string) {
+    // the string is copied in a block of its own, the names around it share the current block
+    std::string text = "var a = 'hi'\nvar b = '" + std::string(40000, 'x') + "'\nvar c = 'hey'";
+
+    char input[40000 + sizeof("var a = 'hi'\nvar b = ''\nvar c = 'hey'")];
+    memcpy(input, text.c_str(), sizeof(input));
+
+    INIT();
+
+    struct node* root;
+    EXPECT_EQ(parse(&p, &root), 0);
+
+    EXPECT_NODE(root, NODE_BLOCK);
+
+    // the statements are linked from the last one
+    struct node* statement = root->left;
+    EXPECT_STREQ(statement->left->token.value, "c");
+    EXPECT_STREQ(statement->left->left->token.value, "hey");
+
+    statement = statement->right;
+    EXPECT_STREQ(statement->left->token.value, "b");
+    EXPECT_EQ(strlen(statement->left->left->token.value), 40000u);
+    EXPECT_EQ(statement->left->left->token.value[39999], 'x');
+
+    statement = statement->right;
+    EXPECT_STREQ(statement->left->token.value, "a");
+    EXPECT_STREQ(statement->left->left->token.value, "hi");
 }
@@ -12,8 +12,11 @@ extern "C" {
     TEST(test_run, name)
 
 #define RUN(file_name, expected_output) \
+    RUN_CONFIG(NULL, file_name, expected_output)
+
+#define RUN_CONFIG(config, file_name, expected_output) \
 { \
-    struct sylk* s = sylk_new(NULL, NULL); \
+    struct sylk* s = sylk_new(config, NULL); \
     sylk_load_prelude(s); \
 \
     FILE* output = fopen("./output.txt", "w+"); \
@@ -57,10 +60,178 @@ TEST_RUN(classes) {
     RUN("member_access.slk", "33");
     RUN("index_access.slk", "155");
     RUN("list.slk", "60");
+    RUN("list_set.slk", "42");
+
+    // a failing built-in method stops the program
+    struct sylk* s = sylk_new(NULL, NULL);
+    sylk_load_prelude(s);
+
+    EXPECT_NE(sylk_run_file(s, "./test/sources/list_pop_empty.slk"), 0);
+    sylk_free(s);
+}
+
+TEST_RUN(loops) {
+    RUN("for.slk", "180\n60");
+}
+
+TEST_RUN(memo) {
+    struct sylk_config small_config = {
+        .memo_size = 2
+    };
+
+    // the size is clamped and the table grows with the entries
+    struct sylk_config huge_config = {
+        .memo_size = UINT32_MAX
+    };
+
+    struct sylk_config gc_config = {
+        .gc_mark_budget = 16
+    };
+
+    RUN("memo.slk", "102334155\nhello sylk\nhello sylk");
+    RUN_CONFIG(&huge_config, "memo.slk", "102334155\nhello sylk\nhello sylk");
+    RUN_CONFIG(&small_config, "memo_evict.slk", "miss 1\nmiss 2\nmiss 3\nmiss 2\nmiss 3\n9\nmiss list\n5\nmiss list\n5");
+    RUN("memo_gc.slk", "miss box\n7\nmemoized text");
+    RUN_CONFIG(&gc_config, "memo_gc.slk", "miss box\n7\nmemoized text");
+
+    // the cached results must survive collections of both generations
+    struct sylk* s = sylk_new(NULL, NULL);
+    sylk_load_prelude(s);
+
+    EXPECT_EQ(sylk_run_file(s, "./test/sources/memo_gc.slk"), 0);
+
+    struct sylk_gc_stats stats;
+    EXPECT_EQ(sylk_gc_stats(s, &stats), 0);
+    sylk_free(s);
+
+    EXPECT_GT(stats.n_minor, 0u);
+    EXPECT_GT(stats.n_major, 0u);
+}
+
+TEST_RUN(lazy) {
+    struct sylk_config config = {
+        .lazy_compile = true
+    };
+
+    RUN("lazy.slk", "14\n42");
+    RUN_CONFIG(&config, "lazy.slk", "14\n42");
+}
+
+TEST_RUN(threads) {
+    struct sylk_config config = {
+        .compile_threads = 4
+    };
+
+    RUN("functions.slk", "324");
+    RUN_CONFIG(&config, "functions.slk", "324");
+}
+
+TEST_RUN(gc) {
+    struct sylk_config config = {
+        .gc_mark_budget = 16
+    };
+
+    struct sylk_config parallel_config = {
+        .gc_threads = 4
+    };
+
+    struct sylk_config parallel_incremental_config = {
+        .gc_mark_budget = 1024,
+        .gc_threads = 4
+    };
+
+    RUN("heap.slk", "499500");
+    RUN_CONFIG(&config, "old_garbage.slk", "120000");
+    RUN_CONFIG(&parallel_config, "old_garbage.slk", "120000");
+    RUN_CONFIG(&parallel_incremental_config, "old_garbage.slk", "120000");
+
+    // the old lists are only freed by major collections
+    for (const struct sylk_config* c : {&config, &parallel_config, &parallel_incremental_config}) {
+        struct sylk* s = sylk_new(c, NULL);
+        sylk_load_prelude(s);
+
+        EXPECT_EQ(sylk_run_file(s, "./test/sources/old_garbage.slk"), 0);
+
+        struct sylk_gc_stats stats;
+        EXPECT_EQ(sylk_gc_stats(s, &stats), 0);
+        sylk_free(s);
+
+        EXPECT_GT(stats.n_major, 0u);
+    }
+}
+
+// events counted by phase
+static void count_gc_events(const struct sylk_gc_event* event, void* ctx) {
+    ++((uint64_t*)ctx)[event->phase];
+}
+
+TEST_RUN(gc_stats) {
+    uint64_t n_events[SYLK_GC_SWEEP + 1] = {};
+
+    struct sylk_config config = {
+        .gc_callback = count_gc_events
+    };
+
+    RUN("garbage.slk", "1249975000");
+
+    struct sylk* s = sylk_new(&config, n_events);
+    sylk_load_prelude(s);
+
+    EXPECT_EQ(sylk_run_file(s, "./test/sources/garbage.slk"), 0);
+
+    struct sylk_gc_stats stats;
+    EXPECT_EQ(sylk_gc_stats(s, &stats), 0);
+    sylk_free(s);
+
+    EXPECT_GE(stats.allocated_objects, 50000u);
+    EXPECT_GT(stats.n_minor, 0u);
+    EXPECT_EQ(stats.freed_objects + stats.live_objects, stats.allocated_objects);
+    EXPECT_EQ(n_events[SYLK_GC_MINOR], stats.n_minor);
+    EXPECT_EQ(n_events[SYLK_GC_MARK_START], stats.n_major);
+    EXPECT_EQ(n_events[SYLK_GC_SWEEP], stats.n_major);
+}
+
+TEST_RUN(gc_stats_incremental) {
+    uint64_t n_events[SYLK_GC_SWEEP + 1] = {};
+
+    struct sylk_config run_config = {
+        .gc_mark_budget = 1024
+    };
+
+    struct sylk_config config = {
+        .gc_mark_budget = 1024,
+        .gc_callback = count_gc_events
+    };
+
+    RUN_CONFIG(&run_config, "old_garbage.slk", "120000");
+
+    struct sylk* s = sylk_new(&config, n_events);
+    sylk_load_prelude(s);
+
+    EXPECT_EQ(sylk_run_file(s, "./test/sources/old_garbage.slk"), 0);
+
+    struct sylk_gc_stats stats;
+    EXPECT_EQ(sylk_gc_stats(s, &stats), 0);
+    sylk_free(s);
+
+    // the program ends with young garbage only, so the last marking is finished and swept
+    EXPECT_GT(stats.n_major, 0u);
+    EXPECT_GT(stats.n_slices, 0u);
+    EXPECT_EQ(n_events[SYLK_GC_MINOR], stats.n_minor);
+    EXPECT_EQ(n_events[SYLK_GC_MARK_START], stats.n_major);
+    EXPECT_EQ(n_events[SYLK_GC_MARK_SLICE], stats.n_slices);
+    EXPECT_EQ(n_events[SYLK_GC_MARK_FINISH], stats.n_major);
+    EXPECT_EQ(n_events[SYLK_GC_SWEEP], stats.n_major);
 }
 
 TEST_RUN(conversions) {
     RUN("strings.slk", "hello10")
+    RUN("long_strings.slk", "true\nfalse\nfalse")
+    RUN("intern.slk", "true\ntrue\nfalse")
+    RUN("ropes.slk", "true\ntrue\nfalse\nxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx")
+    RUN("small_strings.slk", "true\ntrue\ntrue\nfalse\n1234")
+    RUN("keywords.slk", "91")
     RUN("numbers.slk", "77")
+    RUN("wide_numbers.slk", "9000000000000000000\n3000000000000000000\n1\n3.0\n0.30000000000000004\n3\n3.5\ntrue\ntrue\n-9223372036854775806\n-0.53.25")
 }
 